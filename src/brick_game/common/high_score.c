@@ -0,0 +1,461 @@
+#include "high_score.h"
+
+// Not in the header: unistd.h declares a pause() which clashes with
+// the pause state of tetris.
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// @file
+static pthread_once_t store_once = PTHREAD_ONCE_INIT;
+static HighScore_t store;
+
+/**
+ * @brief High score init
+ *
+ * Initializes the locks and the conditions of the store, the leaderboard
+ * isn't open yet.
+ */
+static void highScoreInit() {
+  pthread_mutex_init(&store.lock, NULL);
+  pthread_cond_init(&store.wake, NULL);
+  pthread_cond_init(&store.idle, NULL);
+  pthread_mutex_init(&store.board_lock, NULL);
+  store.board.fd = -1;
+}
+
+/**
+ * @brief High score store
+ *
+ * Initializes the store one time and returns it every time this
+ * function is called.
+ *
+ * @return High score struct
+ */
+HighScore_t *highScoreStore() {
+  pthread_once(&store_once, highScoreInit);
+
+  return &store;
+}
+
+/**
+ * @brief High score set path
+ *
+ * Sets the file the high score is kept in. The score is read from it
+ * again on the next load, the leaderboard next to it is opened on next
+ * use. Without a path the score is only kept in memory.
+ *
+ * @param path Path of the file or NULL
+ */
+void highScoreSetPath(const char *path) {
+  HighScore_t *hs = highScoreStore();
+
+  pthread_mutex_lock(&hs->lock);
+  snprintf(hs->path, sizeof(hs->path), "%s", path ? path : "");
+  hs->configured = 1;
+  hs->loaded = 0;
+  pthread_mutex_unlock(&hs->lock);
+  highScoreCloseBoard(hs);
+}
+
+/**
+ * @brief High score load
+ *
+ * Returns the high score from memory. Only the first call reads it from
+ * the file: the one set by highScoreSetPath(), else the one from the
+ * BRICKGAME_HIGH_SCORE environment variable, else the default one.
+ *
+ * @param default_path Path of the file if no other is set
+ *
+ * @return High score
+ */
+int highScoreLoad(const char *default_path) {
+  HighScore_t *hs = highScoreStore();
+  int score;
+
+  pthread_mutex_lock(&hs->lock);
+  if (!hs->loaded) {
+    const char *env = getenv(HIGH_SCORE_ENV);
+
+    if (!hs->configured)
+      snprintf(hs->path, sizeof(hs->path), "%s", env ? env : default_path);
+
+    FILE *fp = hs->path[0] ? fopen(hs->path, "r") : NULL;
+    hs->score = 0;
+    if (fp) {
+      if (fscanf(fp, "%d", &hs->score) != 1) hs->score = 0;
+      fclose(fp);
+    }
+    hs->saved = hs->score;
+    hs->loaded = 1;
+  }
+  score = hs->score;
+  pthread_mutex_unlock(&hs->lock);
+
+  return score;
+}
+
+/**
+ * @brief High score submit
+ *
+ * Offers a score of a finished game. A new high score is kept in memory
+ * right away and handed to the writer thread, which is started with the
+ * first one. Never waits for the disk.
+ *
+ * @param score Score of the game
+ */
+void highScoreSubmit(int score) {
+  HighScore_t *hs = highScoreStore();
+
+  pthread_mutex_lock(&hs->lock);
+  if (hs->loaded && score > hs->score) {
+    hs->score = score;
+    highScoreStart(hs);
+    pthread_cond_signal(&hs->wake);
+  }
+  pthread_mutex_unlock(&hs->lock);
+}
+
+/**
+ * @brief High score record
+ *
+ * Offers the result of a finished game. Its score is submitted as
+ * a high score, the result itself is handed to the writer thread, which
+ * puts it into the leaderboard. Results which come while the writer
+ * thread already has LEADERBOARD_PENDING of them are dropped.
+ *
+ * @param entry Result of the game
+ */
+void highScoreRecord(const LeaderEntry_t *entry) {
+  HighScore_t *hs = highScoreStore();
+
+  pthread_mutex_lock(&hs->lock);
+  if (hs->loaded && hs->path[0] && hs->pending_count < LEADERBOARD_PENDING) {
+    hs->pending[hs->pending_count++] = *entry;
+    highScoreStart(hs);
+    pthread_cond_signal(&hs->wake);
+  }
+  pthread_mutex_unlock(&hs->lock);
+  highScoreSubmit(entry->score);
+}
+
+/**
+ * @brief High score leaders
+ *
+ * Reads the leaderboard kept next to the high score file. Reads
+ * the shared mapping of the file under the shared lock, so results put
+ * in by other processes are seen as well.
+ *
+ * @param entries Array of LEADERBOARD_SIZE entries to fill
+ *
+ * @return Number of entries read
+ */
+int highScoreLeaders(LeaderEntry_t *entries) {
+  HighScore_t *hs = highScoreStore();
+  char path[HIGH_SCORE_PATH_SIZE];
+  int count = 0;
+
+  pthread_mutex_lock(&hs->lock);
+  memcpy(path, hs->path, sizeof(path));
+  pthread_mutex_unlock(&hs->lock);
+
+  if (path[0]) {
+    pthread_mutex_lock(&hs->board_lock);
+    Leaderboard_t *board = highScoreBoard(hs, path);
+    if (board) count = leaderboardRead(board, entries);
+    pthread_mutex_unlock(&hs->board_lock);
+  }
+
+  return count;
+}
+
+/**
+ * @brief High score start
+ *
+ * Starts the writer thread if it's not running yet and there is a file
+ * to write to. Called with the lock held.
+ *
+ * @param hs High score struct
+ */
+void highScoreStart(HighScore_t *hs) {
+  if (!hs->started && hs->path[0] &&
+      pthread_create(&hs->writer, NULL, highScoreWriter, hs) == 0) {
+    hs->started = 1;
+    atexit(highScoreStop);
+  }
+}
+
+/**
+ * @brief High score flush
+ *
+ * Waits until the writer thread has written the newest high score
+ * and put all the results into the leaderboard.
+ */
+void highScoreFlush() {
+  HighScore_t *hs = highScoreStore();
+
+  pthread_mutex_lock(&hs->lock);
+  while (hs->started &&
+         (hs->writing || hs->saved != hs->score || hs->pending_count))
+    pthread_cond_wait(&hs->idle, &hs->lock);
+  pthread_mutex_unlock(&hs->lock);
+}
+
+/**
+ * @brief High score stop
+ *
+ * Lets the writer thread write the newest high score, waits for it
+ * to finish and closes the leaderboard. Called at exit.
+ */
+void highScoreStop() {
+  HighScore_t *hs = highScoreStore();
+  int started;
+
+  pthread_mutex_lock(&hs->lock);
+  started = hs->started;
+  hs->stopping = 1;
+  pthread_cond_signal(&hs->wake);
+  pthread_mutex_unlock(&hs->lock);
+
+  if (started) pthread_join(hs->writer, NULL);
+  highScoreCloseBoard(hs);
+}
+
+/**
+ * @brief High score writer
+ *
+ * The writer thread. Sleeps until there is a high score newer than
+ * the one on disk or results for the leaderboard, and writes them.
+ * New scores which come during a write are merged into the next one.
+ *
+ * @param arg High score struct
+ *
+ * @return NULL
+ */
+void *highScoreWriter(void *arg) {
+  HighScore_t *hs = (HighScore_t *)arg;
+  char path[HIGH_SCORE_PATH_SIZE];
+  LeaderEntry_t entries[LEADERBOARD_PENDING];
+
+  pthread_mutex_lock(&hs->lock);
+  while (hs->saved != hs->score || hs->pending_count || !hs->stopping) {
+    if (hs->saved == hs->score && !hs->pending_count) {
+      pthread_cond_wait(&hs->wake, &hs->lock);
+    } else {
+      int score = hs->score;
+      int write = hs->saved != score;
+      int count = hs->pending_count;
+      int written = -1;
+
+      memcpy(entries, hs->pending, count * sizeof(LeaderEntry_t));
+      hs->pending_count = 0;
+      snprintf(path, sizeof(path), "%s", hs->path);
+      hs->writing = 1;
+      pthread_mutex_unlock(&hs->lock);
+      if (path[0] && write) written = highScoreWrite(path, score);
+      if (path[0] && count) highScorePublish(hs, path, entries, count);
+      pthread_mutex_lock(&hs->lock);
+      hs->writing = 0;
+      if (written > hs->score) hs->score = written;
+      hs->saved = written > score ? written : score;
+      pthread_cond_broadcast(&hs->idle);
+    }
+  }
+  pthread_mutex_unlock(&hs->lock);
+
+  return NULL;
+}
+
+/**
+ * @brief High score write
+ *
+ * Writes the score into the file unless the file already holds a higher
+ * one, which another process has saved since this one has read it.
+ * The file is locked while its score is read and replaced, so processes
+ * sharing it write one after another. The score goes into a temporary
+ * file of a unique name next to the given one, which is synced and
+ * renamed over it, and the directory is synced after the rename, so
+ * the file always holds a whole score, even if the program or the system
+ * dies during the write.
+ *
+ * @param path Path of the file
+ * @param score Score to write
+ *
+ * @return Score the file holds now, -1 on failure
+ */
+int highScoreWrite(const char *path, int score) {
+  char tmp[HIGH_SCORE_PATH_SIZE + 8];
+  int result = -1;
+  int lock = highScoreLock(path);
+
+  if (lock >= 0) {
+    int saved = highScoreRead(lock);
+    int fd;
+
+    if (saved > score) score = saved;
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+    fd = mkstemp(tmp);
+    if (fd >= 0) {
+      FILE *fp = fdopen(fd, "w");
+      int written = fp && fchmod(fd, 0644) == 0 &&
+                    fprintf(fp, "%d", score) > 0 && fflush(fp) == 0 &&
+                    fsync(fd) == 0;
+      int closed = fp ? fclose(fp) == 0 : close(fd) == 0;
+
+      if (closed && written && rename(tmp, path) == 0) {
+        highScoreSyncDir(path);
+        result = score;
+      } else {
+        remove(tmp);
+      }
+    }
+    close(lock);
+  }
+
+  return result;
+}
+
+/**
+ * @brief High score lock
+ *
+ * Opens the high score file, creates it if there is none, and locks it
+ * exclusively. A file which has been renamed over while waiting for
+ * the lock is not the file any more, the new one is locked instead.
+ *
+ * @param path Path of the file
+ *
+ * @return Locked descriptor, closing it unlocks, -1 on failure
+ */
+int highScoreLock(const char *path) {
+  int fd = -1;
+  int locked = 0;
+
+  while (!locked) {
+    struct stat held;
+    struct stat current;
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || flock(fd, LOCK_EX) != 0 || fstat(fd, &held) != 0) {
+      if (fd >= 0) close(fd);
+      fd = -1;
+      locked = 1;
+    } else if (stat(path, &current) == 0 && current.st_dev == held.st_dev &&
+               current.st_ino == held.st_ino) {
+      locked = 1;
+    } else {
+      close(fd);
+    }
+  }
+
+  return fd;
+}
+
+/**
+ * @brief High score read
+ *
+ * Reads the score of an open high score file.
+ *
+ * @param fd Descriptor of the file
+ *
+ * @return Score, 0 if the file holds none
+ */
+int highScoreRead(int fd) {
+  char buffer[32];
+  ssize_t length = pread(fd, buffer, sizeof(buffer) - 1, 0);
+  int score = 0;
+
+  if (length > 0) {
+    buffer[length] = '\0';
+    if (sscanf(buffer, "%d", &score) != 1) score = 0;
+  }
+
+  return score;
+}
+
+/**
+ * @brief High score sync dir
+ *
+ * Syncs the directory of a file, which makes a rename in it durable.
+ *
+ * @param path Path of the file
+ *
+ * @return 0 on success, -1 on failure
+ */
+int highScoreSyncDir(const char *path) {
+  char dir[HIGH_SCORE_PATH_SIZE];
+  const char *slash = strrchr(path, '/');
+  int result = -1;
+
+  if (!slash)
+    snprintf(dir, sizeof(dir), ".");
+  else if (slash == path)
+    snprintf(dir, sizeof(dir), "/");
+  else
+    snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+
+  int fd = open(dir, O_RDONLY | O_DIRECTORY);
+  if (fd >= 0) {
+    result = fsync(fd);
+    close(fd);
+  }
+
+  return result;
+}
+
+/**
+ * @brief High score board
+ *
+ * Returns the leaderboard of the store kept next to the given high score
+ * file, opening it first if it isn't open or is open for another file.
+ * Called with the board lock held.
+ *
+ * @param hs High score struct
+ * @param path Path of the high score file
+ *
+ * @return Leaderboard struct or NULL if it can't be opened
+ */
+Leaderboard_t *highScoreBoard(HighScore_t *hs, const char *path) {
+  char board_path[sizeof(hs->board_path)];
+
+  leaderboardPath(board_path, sizeof(board_path), path);
+  if (hs->board.file && strcmp(board_path, hs->board_path))
+    leaderboardClose(&hs->board);
+  if (!hs->board.file && !leaderboardOpen(&hs->board, board_path))
+    snprintf(hs->board_path, sizeof(hs->board_path), "%s", board_path);
+
+  return hs->board.file ? &hs->board : NULL;
+}
+
+/**
+ * @brief High score close board
+ *
+ * Closes the leaderboard of the store if it is open.
+ *
+ * @param hs High score struct
+ */
+void highScoreCloseBoard(HighScore_t *hs) {
+  pthread_mutex_lock(&hs->board_lock);
+  if (hs->board.file) leaderboardClose(&hs->board);
+  pthread_mutex_unlock(&hs->board_lock);
+}
+
+/**
+ * @brief High score publish
+ *
+ * Puts the results into the leaderboard kept next to the high score
+ * file, each under the exclusive lock.
+ *
+ * @param hs High score struct
+ * @param path Path of the high score file
+ * @param entries Results of finished games
+ * @param count Number of results
+ */
+void highScorePublish(HighScore_t *hs, const char *path,
+                      const LeaderEntry_t *entries, int count) {
+  pthread_mutex_lock(&hs->board_lock);
+  Leaderboard_t *board = highScoreBoard(hs, path);
+  for (int i = 0; board && i < count; i++)
+    leaderboardInsert(board, &entries[i]);
+  pthread_mutex_unlock(&hs->board_lock);
+}
@@ -0,0 +1,86 @@
+#ifndef HIGH_SCORE_H
+#define HIGH_SCORE_H
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+/// @file
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "leaderboard.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HIGH_SCORE_ENV "BRICKGAME_HIGH_SCORE"
+#define HIGH_SCORE_PATH_SIZE 4096
+
+/**
+ * @brief High score struct
+ *
+ * The high score store of the program, shared by all of its games: the
+ * lock and the conditions of the writer thread, the writer thread, path,
+ * load, start and stop flags, the best score in memory, the last score
+ * written to disk, whether a write is in progress, the path of the
+ * file, empty if the score is only kept in memory, the results of
+ * finished games waiting to be put into the leaderboard, and
+ * the leaderboard kept open for the store with its own lock and path.
+ *
+ * Games only read and update the score in memory. The file is read once
+ * and written by the writer thread, which also keeps the leaderboard
+ * next to it, so a game never waits for the disk.
+ *
+ * The leaderboard is opened on first use and stays mapped until the path
+ * changes or the store stops. Its lock is taken around every use of it:
+ * the flock() of the file belongs to the one open descriptor, so threads
+ * of the process must not lock and unlock it over each other.
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t idle;
+  pthread_t writer;
+  int configured;
+  int loaded;
+  int started;
+  int stopping;
+  int score;
+  int saved;
+  int writing;
+  char path[HIGH_SCORE_PATH_SIZE];
+  LeaderEntry_t pending[LEADERBOARD_PENDING];
+  int pending_count;
+  pthread_mutex_t board_lock;
+  Leaderboard_t board;
+  char board_path[HIGH_SCORE_PATH_SIZE + sizeof(LEADERBOARD_EXTENSION)];
+} HighScore_t;
+
+HighScore_t *highScoreStore();
+void highScoreSetPath(const char *path);
+int highScoreLoad(const char *default_path);
+void highScoreSubmit(int score);
+void highScoreRecord(const LeaderEntry_t *entry);
+int highScoreLeaders(LeaderEntry_t *entries);
+void highScoreFlush();
+void highScoreStop();
+void *highScoreWriter(void *arg);
+int highScoreWrite(const char *path, int score);
+int highScoreLock(const char *path);
+int highScoreRead(int fd);
+int highScoreSyncDir(const char *path);
+void highScoreStart(HighScore_t *hs);
+Leaderboard_t *highScoreBoard(HighScore_t *hs, const char *path);
+void highScoreCloseBoard(HighScore_t *hs);
+void highScorePublish(HighScore_t *hs, const char *path,
+                      const LeaderEntry_t *entries, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
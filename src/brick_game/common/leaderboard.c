@@ -0,0 +1,166 @@
+#include "leaderboard.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// @file
+/**
+ * @brief Leaderboard open
+ *
+ * Opens the leaderboard file, creates it if there is none, and maps it.
+ * A file of the wrong size or format is reset to an empty leaderboard.
+ *
+ * @param board Leaderboard struct
+ * @param path Path of the file
+ *
+ * @return 0 on success, -1 on failure
+ */
+int leaderboardOpen(Leaderboard_t *board, const char *path) {
+  int result = -1;
+
+  board->file = NULL;
+  board->fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (board->fd >= 0 && flock(board->fd, LOCK_EX) == 0) {
+    struct stat st;
+
+    if (fstat(board->fd, &st) == 0 &&
+        (st.st_size == (off_t)sizeof(LeaderFile_t) ||
+         ftruncate(board->fd, sizeof(LeaderFile_t)) == 0)) {
+      void *map = mmap(NULL, sizeof(LeaderFile_t), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, board->fd, 0);
+
+      if (map != MAP_FAILED) {
+        board->file = (LeaderFile_t *)map;
+        if (st.st_size != (off_t)sizeof(LeaderFile_t) ||
+            !leaderboardValid(board->file)) {
+          memset(board->file, 0, sizeof(LeaderFile_t));
+          board->file->magic = LEADERBOARD_MAGIC;
+          board->file->version = LEADERBOARD_VERSION;
+          board->file->capacity = LEADERBOARD_SIZE;
+        }
+        result = 0;
+      }
+    }
+    flock(board->fd, LOCK_UN);
+  }
+  if (result) leaderboardClose(board);
+
+  return result;
+}
+
+/**
+ * @brief Leaderboard insert
+ *
+ * Inserts an entry under the exclusive lock if its score makes it into
+ * the leaderboard. The worst entry falls out of a full one. A count
+ * beyond the capacity, written by another process, is clamped to it.
+ *
+ * @param board Leaderboard struct
+ * @param entry Entry to insert
+ *
+ * @return Place of the entry counting from 0, -1 if it didn't make it
+ */
+int leaderboardInsert(Leaderboard_t *board, const LeaderEntry_t *entry) {
+  int place = -1;
+
+  if (board->file && flock(board->fd, LOCK_EX) == 0) {
+    LeaderFile_t *file = board->file;
+    uint32_t stored = file->count;
+    int count = stored < LEADERBOARD_SIZE ? (int)stored : LEADERBOARD_SIZE;
+
+    place = 0;
+    while (place < count && file->entries[place].score >= entry->score)
+      place++;
+    if (place < LEADERBOARD_SIZE) {
+      int moved = (count < LEADERBOARD_SIZE ? count : count - 1) - place;
+
+      memmove(&file->entries[place + 1], &file->entries[place],
+              moved * sizeof(LeaderEntry_t));
+      file->entries[place] = *entry;
+      file->count = count < LEADERBOARD_SIZE ? count + 1 : LEADERBOARD_SIZE;
+      msync(file, sizeof(LeaderFile_t), MS_ASYNC);
+    } else {
+      place = -1;
+    }
+    flock(board->fd, LOCK_UN);
+  }
+
+  return place;
+}
+
+/**
+ * @brief Leaderboard read
+ *
+ * Copies the entries out under the shared lock. The mapping can be
+ * rewritten by any process after it has been opened, so a count beyond
+ * the capacity is clamped to it.
+ *
+ * @param board Leaderboard struct
+ * @param entries Array of LEADERBOARD_SIZE entries to fill
+ *
+ * @return Number of entries copied
+ */
+int leaderboardRead(Leaderboard_t *board, LeaderEntry_t *entries) {
+  int count = 0;
+
+  if (board->file && flock(board->fd, LOCK_SH) == 0) {
+    uint32_t stored = board->file->count;
+
+    count = stored < LEADERBOARD_SIZE ? (int)stored : LEADERBOARD_SIZE;
+    memcpy(entries, board->file->entries, count * sizeof(LeaderEntry_t));
+    flock(board->fd, LOCK_UN);
+  }
+
+  return count;
+}
+
+/**
+ * @brief Leaderboard close
+ *
+ * Unmaps and closes the leaderboard file.
+ *
+ * @param board Leaderboard struct
+ */
+void leaderboardClose(Leaderboard_t *board) {
+  if (board->file) munmap(board->file, sizeof(LeaderFile_t));
+  if (board->fd >= 0) close(board->fd);
+  board->file = NULL;
+  board->fd = -1;
+}
+
+/**
+ * @brief Leaderboard valid
+ *
+ * Checks the header of a mapped file.
+ *
+ * @param file Leader file struct
+ *
+ * @return Whether the file is a leaderboard of this format
+ */
+int leaderboardValid(const LeaderFile_t *file) {
+  return file->magic == LEADERBOARD_MAGIC &&
+         file->version == LEADERBOARD_VERSION &&
+         file->capacity == LEADERBOARD_SIZE && file->count <= LEADERBOARD_SIZE;
+}
+
+/**
+ * @brief Leaderboard path
+ *
+ * Makes the path of the leaderboard kept next to the high score file:
+ * the same name with the extension replaced by .board.
+ *
+ * @param dest Buffer for the path
+ * @param size Size of the buffer
+ * @param path Path of the high score file
+ */
+void leaderboardPath(char *dest, size_t size, const char *path) {
+  const char *slash = strrchr(path, '/');
+  const char *name = slash ? slash + 1 : path;
+  const char *dot = strrchr(name, '.');
+  int length = dot && dot != name ? (int)(dot - path) : (int)strlen(path);
+
+  snprintf(dest, size, "%.*s%s", length, path, LEADERBOARD_EXTENSION);
+}
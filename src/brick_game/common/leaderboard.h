@@ -0,0 +1,84 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+/// @file
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LEADERBOARD_SIZE 10
+#define LEADERBOARD_PENDING 16
+#define LEADERBOARD_MAGIC 0x424c4742u
+#define LEADERBOARD_VERSION 1u
+#define LEADERBOARD_EXTENSION ".board"
+
+/**
+ * @brief Leader entry struct
+ *
+ * One result of a finished game: score, level, lines removed in tetris
+ * or apples eaten in snake, duration of the game in milliseconds, state
+ * of the random generator the game started with and the wall clock time
+ * it ended at in seconds since the epoch.
+ *
+ * All fields have fixed sizes, an entry is kept in the file as it is.
+ */
+typedef struct {
+  int32_t score;
+  int32_t level;
+  int32_t count;
+  uint32_t reserved;
+  int64_t duration;
+  uint64_t seed;
+  int64_t timestamp;
+} LeaderEntry_t;
+
+/**
+ * @brief Leader file struct
+ *
+ * Layout of the leaderboard file: magic number, format version,
+ * capacity, number of entries and the entries sorted by score, best
+ * first. Entries with equal scores keep the order they came in.
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t count;
+  LeaderEntry_t entries[LEADERBOARD_SIZE];
+} LeaderFile_t;
+
+/**
+ * @brief Leaderboard struct
+ *
+ * An open leaderboard: descriptor of the file, which is also the one
+ * locked with flock(), and the shared mapping of it.
+ *
+ * Every process maps the same file, so an entry inserted by one of them
+ * is seen by the others without a read. The advisory lock is held only
+ * while the mapping is read or changed.
+ */
+typedef struct {
+  int fd;
+  LeaderFile_t *file;
+} Leaderboard_t;
+
+int leaderboardOpen(Leaderboard_t *board, const char *path);
+int leaderboardInsert(Leaderboard_t *board, const LeaderEntry_t *entry);
+int leaderboardRead(Leaderboard_t *board, LeaderEntry_t *entries);
+void leaderboardClose(Leaderboard_t *board);
+int leaderboardValid(const LeaderFile_t *file);
+void leaderboardPath(char *dest, size_t size, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
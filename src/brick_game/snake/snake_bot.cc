@@ -0,0 +1,298 @@
+#include "snake_bot.h"
+
+#include <cstring>
+
+#include "snake_model.h"
+
+/// @file
+/**
+ * @brief Decide
+ *
+ * Returns the action the autopilot makes now: Start on a start screen
+ * or after a finished game, the turn towards the chosen cell or
+ * an acceleration into it while the snake is moving, Up otherwise.
+ *
+ * @return User action enum
+ */
+UserAction_t s21::SnakeBot::decide() {
+  UserAction_t action = Up;
+  int pause = this->prms->stats.pause;
+
+  if (pause == STARTING || pause == GAMELOST || pause == GAMEWON) {
+    action = Start;
+  } else if (this->prms->state == MOVING && pause == PLAYING) {
+    int cell = chooseCell();
+    if (cell >= 0) action = steer(cell);
+  }
+
+  return action;
+}
+
+/**
+ * @brief Choose cell
+ *
+ * Chooses the cell the head moves into next: the next cell of the cycle,
+ * or a free neighbour cell further along the cycle which is closer to
+ * the apple. The shortcut may neither pass the apple nor come up to
+ * the tail in the cycle order, and the head must still be able to reach
+ * the tail from there.
+ *
+ * @return Packed cell
+ */
+int s21::SnakeBot::chooseCell() {
+  SnakeBody::Node head = this->prms->body->getHead();
+  SnakeBody::Node tail = this->prms->body->getTail();
+  int head_cell = head.y * FIELD_WIDTH + head.x;
+  int tail_cell = tail.y * FIELD_WIDTH + tail.x;
+  int apple = this->prms->apple.x < 0
+                  ? -1
+                  : this->prms->apple.y * FIELD_WIDTH + this->prms->apple.x;
+  int to_tail = cycleAhead(head_cell, tail_cell);
+  int to_apple = apple < 0 ? 0 : cycleAhead(head_cell, apple);
+  int chosen = -1;
+  int chosen_ahead = 1;
+
+  loadGrid();
+  distanceField(apple);
+  for (int direction = LOOKLEFT; chosen < 0 && direction <= LOOKDOWN;
+       ++direction) {
+    int cell = neighbour(head_cell, direction);
+    if (cell >= 0 && cycleAhead(head_cell, cell) == 1) chosen = cell;
+  }
+  for (int direction = LOOKLEFT; direction <= LOOKDOWN; ++direction) {
+    int cell = neighbour(head_cell, direction);
+    int ahead = cell >= 0 ? cycleAhead(head_cell, cell) : 0;
+
+    if (ahead > 1 && ahead < to_tail && ahead <= to_apple &&
+        !this->grid[cell] &&
+        (distance(cell) < distance(chosen) ||
+         (distance(cell) == distance(chosen) && ahead > chosen_ahead)) &&
+        tailReachable(cell, cell == apple)) {
+      chosen = cell;
+      chosen_ahead = ahead;
+    }
+  }
+
+  return chosen;
+}
+
+/**
+ * @brief Tail reachable
+ *
+ * Tells if the head moved into the cell can still reach the tail, with
+ * a breadth-first search in which a snake segment can be entered as soon
+ * as the tail has left it. Entering such a cell puts the head right
+ * behind the tail, which it can follow from then on. Without an apple
+ * the tail moves away with the head, so every segment leaves its cell
+ * one move earlier.
+ *
+ * @param cell Packed cell the head moves into
+ * @param grows Whether the snake eats an apple there
+ *
+ * @return Whether the tail can be reached
+ */
+bool s21::SnakeBot::tailReachable(int cell, bool grows) {
+  bool reached = false;
+  int moves = grows ? 0 : 1;
+  int head = 0;
+  int end = 0;
+
+  this->search_generation =
+      nextGeneration(this->search_marks, this->search_generation);
+  this->search_marks[cell] = this->search_generation;
+  this->steps[cell] = 0;
+  this->queue[end++] = static_cast<uint8_t>(cell);
+  while (!reached && head < end) {
+    int current = this->queue[head++];
+    int arrival = this->steps[current] + 1;
+
+    for (int direction = LOOKLEFT; !reached && direction <= LOOKDOWN;
+         ++direction) {
+      int next = neighbour(current, direction);
+
+      if (next >= 0 && this->search_marks[next] != this->search_generation) {
+        int left_at = this->grid[next];
+
+        if (left_at > 0 && left_at <= arrival + moves) {
+          reached = true;
+        } else if (left_at == 0) {
+          this->search_marks[next] = this->search_generation;
+          this->steps[next] = static_cast<uint8_t>(arrival);
+          this->queue[end++] = static_cast<uint8_t>(next);
+        }
+      }
+    }
+  }
+
+  return reached;
+}
+
+/**
+ * @brief Distance field
+ *
+ * Fills the distances of the free cells of the grid from the given one
+ * with a breadth-first search. Without a cell every cell is unreached.
+ *
+ * @param from Packed cell or -1
+ */
+void s21::SnakeBot::distanceField(int from) {
+  int head = 0;
+  int end = 0;
+
+  this->dist_generation =
+      nextGeneration(this->dist_marks, this->dist_generation);
+  if (from >= 0) {
+    this->dist_marks[from] = this->dist_generation;
+    this->dist[from] = 0;
+    this->queue[end++] = static_cast<uint8_t>(from);
+  }
+  while (head < end) {
+    int current = this->queue[head++];
+
+    for (int direction = LOOKLEFT; direction <= LOOKDOWN; ++direction) {
+      int next = neighbour(current, direction);
+
+      if (next >= 0 && !this->grid[next] &&
+          this->dist_marks[next] != this->dist_generation) {
+        this->dist_marks[next] = this->dist_generation;
+        this->dist[next] = static_cast<uint8_t>(this->dist[current] + 1);
+        this->queue[end++] = static_cast<uint8_t>(next);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Steer
+ *
+ * Returns the action which brings the head into the neighbour cell:
+ * an acceleration if the snake looks at it, a turn otherwise. A cell
+ * behind the head takes two turns, the first one is made away from
+ * the neck.
+ *
+ * @param cell Packed neighbour cell of the head
+ *
+ * @return User action enum
+ */
+UserAction_t s21::SnakeBot::steer(int cell) {
+  SnakeBody::Node head = this->prms->body->getHead();
+  SnakeBody::Node neck = this->prms->body->getNeck();
+  int head_cell = head.y * FIELD_WIDTH + head.x;
+  int current = this->prms->direction;
+  int left = (current + 3) % 4;
+  int right = (current + 1) % 4;
+  UserAction_t action;
+
+  if (neighbour(head_cell, current) == cell)
+    action = Action;
+  else if (neighbour(head_cell, left) == cell)
+    action = Left;
+  else if (neighbour(head_cell, right) == cell)
+    action = Right;
+  else if (neighbour(head_cell, left) == neck.y * FIELD_WIDTH + neck.x)
+    action = Right;
+  else
+    action = Left;
+
+  return action;
+}
+
+/**
+ * @brief Neighbour
+ *
+ * Returns the cell next to the given one in a look direction.
+ *
+ * @param cell Packed cell
+ * @param direction Look direction enum
+ *
+ * @return Packed cell or -1 if it's outside of the field
+ */
+int s21::SnakeBot::neighbour(int cell, int direction) const {
+  static const int dx[] = {-1, 0, 1, 0};
+  static const int dy[] = {0, -1, 0, 1};
+  int x = cell % FIELD_WIDTH + dx[direction];
+  int y = cell / FIELD_WIDTH + dy[direction];
+
+  return x < 0 || x >= FIELD_WIDTH || y < 0 || y >= FIELD_HEIGHT
+             ? -1
+             : y * FIELD_WIDTH + x;
+}
+
+/**
+ * @brief Cycle order
+ *
+ * Returns the position of a cell in the Hamiltonian cycle the snake goes
+ * around. The cycle runs up the left column, along the top row and then
+ * row by row in a zigzag over the other columns, and is walked from
+ * the higher positions to the lower ones. The snake starts in a column,
+ * going up, so its body lies along the cycle from the start.
+ *
+ * @param cell Packed cell
+ *
+ * @return Position from 0 to kCells - 1
+ */
+int s21::SnakeBot::cycleOrder(int cell) {
+  int x = cell % FIELD_WIDTH;
+  int y = cell / FIELD_WIDTH;
+  int order;
+
+  if (y == 0)
+    order = x;
+  else if (x == 0)
+    order = kCells - y;
+  else
+    order = FIELD_WIDTH + (y - 1) * (FIELD_WIDTH - 1) +
+            (y % 2 ? FIELD_WIDTH - 1 - x : x - 1);
+
+  return order;
+}
+
+/**
+ * @brief Cycle ahead
+ *
+ * Returns the number of moves along the cycle from one cell to another.
+ *
+ * @param from Packed cell
+ * @param to Packed cell
+ *
+ * @return Number of moves from 0 to kCells - 1
+ */
+int s21::SnakeBot::cycleAhead(int from, int to) {
+  return (cycleOrder(from) - cycleOrder(to) + kCells) % kCells;
+}
+
+/**
+ * @brief Load grid
+ *
+ * Fills the grid with the number of moves after which every snake
+ * segment leaves its cell, 0 for free cells.
+ */
+void s21::SnakeBot::loadGrid() {
+  const SnakeBody &snake = *this->prms->body;
+
+  std::memset(this->grid, 0, sizeof(this->grid));
+  for (int i = 0; i < snake.getSize(); ++i) {
+    SnakeBody::Node node = snake.getNode(i);
+    this->grid[node.y * FIELD_WIDTH + node.x] = static_cast<uint8_t>(i + 1);
+  }
+}
+
+/**
+ * @brief Next generation
+ *
+ * Returns the next generation of visited marks. When the counter wraps
+ * around, the marks are cleared, so old marks are never taken for
+ * new ones.
+ *
+ * @param marks Visited marks
+ * @param generation Current generation
+ *
+ * @return Next generation
+ */
+uint32_t s21::SnakeBot::nextGeneration(uint32_t *marks, uint32_t generation) {
+  if (++generation == 0) {
+    std::memset(marks, 0, kCells * sizeof(uint32_t));
+    generation = 1;
+  }
+  return generation;
+}
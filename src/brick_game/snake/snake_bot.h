@@ -0,0 +1,80 @@
+#ifndef SNAKE_BOT_H
+#define SNAKE_BOT_H
+
+#include <cstdint>
+
+#include "../../common.h"
+
+namespace s21 {
+
+/// @file
+struct Params_t;
+
+/**
+ * @brief SnakeBot class
+ *
+ * This class is the autopilot of the snake.
+ *
+ * The snake goes around a fixed Hamiltonian cycle of the field, its body
+ * always lies along the cycle behind the head, so the head can always
+ * follow the cycle to its tail. Every decision takes a breadth-first
+ * distance field from the apple over the free cells, and the head cuts
+ * the cycle short towards the apple as long as it neither passes
+ * the apple nor the tail in the cycle order, and can still reach the tail.
+ * The tail is searched for on a grid of the moves after which every
+ * segment leaves its cell. Cells are packed like in the snake body
+ * (y * FIELD_WIDTH + x). The grid, queue, distances and visited marks are
+ * preallocated, a search only bumps the mark generation, so a decision
+ * never allocates.
+ */
+class SnakeBot {
+ public:
+  static constexpr int kCells = FIELD_WIDTH * FIELD_HEIGHT;
+  static constexpr int kUnreached = kCells;
+
+  UserAction_t decide();
+  int chooseCell();
+  bool tailReachable(int cell, bool grows);
+  void distanceField(int from);
+  UserAction_t steer(int cell);
+  static int cycleOrder(int cell);
+  static int cycleAhead(int from, int to);
+
+  /**
+   * @brief Distance
+   *
+   * Returns the distance of a cell from the apple in the last distance
+   * field.
+   *
+   * @param cell Packed cell
+   *
+   * @return Number of moves, kUnreached if the apple can't be reached
+   */
+  int distance(int cell) const {
+    return this->dist_marks[cell] == this->dist_generation ? this->dist[cell]
+                                                           : kUnreached;
+  }
+
+  SnakeBot(){};
+
+  explicit SnakeBot(const Params_t &params) : prms(&params){};
+
+ private:
+  void loadGrid();
+  int neighbour(int cell, int direction) const;
+  static uint32_t nextGeneration(uint32_t *marks, uint32_t generation);
+
+  const Params_t *prms{};
+  uint8_t grid[kCells]{};
+  uint8_t queue[kCells]{};
+  uint8_t dist[kCells]{};
+  uint8_t steps[kCells]{};
+  uint32_t dist_marks[kCells]{};
+  uint32_t search_marks[kCells]{};
+  uint32_t dist_generation = 0;
+  uint32_t search_generation = 0;
+};
+
+}  // namespace s21
+
+#endif
@@ -2,22 +2,283 @@
 
 /// @file
 
-static s21::SnakeBody snake_body;
-static s21::Params_t params(snake_body);
-static s21::SnakeModel Snake(params);
+static Game default_game;
 
 /**
  * @brief Update current state
  *
- * Updates game state and clears the signal.
+ * Updates default game state and clears the signal.
  *
  * @return Game info structure
  */
 GameInfo_t updateCurrentState() {
-  Snake.fsm();
-  Snake.setSignal(Up);
+  gameStep(&default_game);
 
-  return Snake.getPrms().stats;
+  return gameSnapshot(&default_game);
+}
+
+/**
+ * @brief Create game
+ *
+ * Allocates a new independent game instance together with its field.
+ * The game starts in the starting screen, like the default one.
+ *
+ * @param seed Seed of the game's random numbers, 0 for a time-based one
+ *
+ * @return Game handle or nullptr if allocation failed
+ */
+Game_t *gameCreate(uint64_t seed) {
+  Game *game = new (std::nothrow) Game;
+
+  if (game) {
+    game->prms.seed = seed;
+    game->model.memAlloc();
+  }
+  return game;
+}
+
+/**
+ * @brief Game step
+ *
+ * Updates game state of the passed instance at the current time
+ * of the monotonic clock.
+ *
+ * @param game Game handle
+ */
+void gameStep(Game_t *game) { gameStepAt(game, gameTime()); }
+
+/**
+ * @brief Game step at
+ *
+ * Updates game state of the passed instance at the passed time. Every
+ * queued input which has to be applied gets its own FSM step in the
+ * order it was made; between two inputs the states which pass on by
+ * themselves are run through, so that no input lands in a state which
+ * ignores it. Then the held action is repeated, if it is due. Without
+ * any of them the FSM is stepped once. A step which changes what views
+ * show makes a new frame version. The time must not go backwards.
+ *
+ * @param game Game handle
+ * @param now Current time in milliseconds
+ */
+void gameStepAt(Game_t *game, int64_t now) {
+  s21::Params_t &prms = game->prms;
+  Input_t input;
+  bool stepped = false;
+
+  prms.now = now;
+  while (inputPop(&prms.inputs, &input)) {
+    bool repeatable = s21::SnakeModel::isRepeatable(input.action);
+
+    if (repeatInput(&prms.repeat, input, repeatable)) {
+      while (stepped && game->model.isTransient()) game->model.fsm();
+      game->model.setSignal(input.action);
+      game->model.fsm();
+      game->model.setSignal(Up);
+      stepped = true;
+    }
+  }
+  if (game->model.autoRepeat() == 0 && !stepped) game->model.fsm();
+  HASH_CHECK(prms.hash, game->model.hashState());
+
+  frameTrack(&prms.track, &prms.stats, prms.board_changed);
+  prms.board_changed = false;
+}
+
+/**
+ * @brief Game deadline
+ *
+ * Tells when the passed instance has to be stepped next, if no input
+ * comes earlier: at the next move or repeat of the held acceleration
+ * while the snake is moving, right away in the states which pass on by
+ * themselves or if there is queued input.
+ *
+ * @param game Game handle
+ *
+ * @return Time in milliseconds or NO_DEADLINE if the game waits for input
+ */
+int64_t gameDeadline(Game_t *game) {
+  const s21::Params_t &prms = game->prms;
+  int64_t deadline = prms.now;
+
+  if (inputPending(&game->prms.inputs))
+    deadline = prms.now;
+  else if (prms.state == MOVING && prms.repeat.active)
+    deadline = std::min(prms.step_at, prms.repeat.next_at);
+  else if (prms.state == MOVING)
+    deadline = prms.step_at;
+  else if (prms.state == START || (prms.state == PAUSE && prms.stats.field))
+    deadline = NO_DEADLINE;
+
+  return deadline;
+}
+
+/**
+ * @brief Game time
+ *
+ * Reads the monotonic clock used by gameStep().
+ *
+ * @return Current time in milliseconds
+ */
+int64_t gameTime() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief Game input
+ *
+ * Queues new action for the passed instance, made at the current time
+ * of the monotonic clock.
+ *
+ * @param game Game handle
+ * @param action User action enum
+ * @param hold Is button held or not
+ */
+void gameInput(Game_t *game, UserAction_t action, bool hold) {
+  gameInputAt(game, action, hold, gameTime());
+}
+
+/**
+ * @brief Game input at
+ *
+ * Queues new action for the passed instance, made at the passed time.
+ * Up means no input and isn't queued. If the queue is full, the action
+ * is dropped and counted.
+ *
+ * @param game Game handle
+ * @param action User action enum
+ * @param hold Is button held or not
+ * @param time Time of the action in milliseconds
+ */
+void gameInputAt(Game_t *game, UserAction_t action, bool hold, int64_t time) {
+  if (action != Up) inputPush(&game->prms.inputs, Input_t{action, hold, time});
+}
+
+/**
+ * @brief Game dropped inputs
+ *
+ * Tells how many actions of the passed instance didn't fit into its
+ * input queue and were dropped.
+ *
+ * @param game Game handle
+ *
+ * @return Number of dropped actions
+ */
+uint64_t gameDroppedInputs(Game_t *game) {
+  return __atomic_load_n(&game->prms.inputs.dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Game set repeat
+ *
+ * Sets the delays of auto-repeat of held acceleration of the passed
+ * instance. Must be called from the thread which steps the game.
+ *
+ * @param game Game handle
+ * @param delay Delay before the first repeat in milliseconds
+ * @param interval Delay between two repeats in milliseconds
+ */
+void gameSetRepeat(Game_t *game, int delay, int interval) {
+  repeatSet(&game->prms.repeat, delay, interval);
+}
+
+/**
+ * @brief Game snapshot
+ *
+ * Returns Game info struct of the passed instance.
+ *
+ * @param game Game handle
+ *
+ * @return Game info struct
+ */
+GameInfo_t gameSnapshot(Game_t *game) { return game->prms.stats; }
+
+/**
+ * @brief Game frame
+ *
+ * Returns a read-only view of the game info struct of the passed
+ * instance with its version and the parts changed after the seen
+ * version.
+ *
+ * @param game Game handle
+ * @param seen Version the caller has seen, 0 if it hasn't seen any
+ *
+ * @return Game frame struct
+ */
+GameFrame_t gameFrame(Game_t *game, uint64_t seen) {
+  const s21::Params_t &prms = game->prms;
+
+  return GameFrame_t{&prms.stats, prms.track.version,
+                     frameChanges(&prms.track, seen)};
+}
+
+/**
+ * @brief Game autoplay
+ *
+ * Returns the action the autopilot makes in the passed instance now,
+ * to be passed to gameInput().
+ *
+ * @param game Game handle
+ *
+ * @return User action enum
+ */
+UserAction_t gameAutoplay(Game_t *game) { return game->bot.decide(); }
+
+/**
+ * @brief Game hash
+ *
+ * Returns the Zobrist hash of the position of the passed instance:
+ * the cells of the snake's body and the apple.
+ *
+ * @param game Game handle
+ *
+ * @return Hash
+ */
+uint64_t gameHash(Game_t *game) { return game->prms.hash; }
+
+/**
+ * @brief Game lines
+ *
+ * Returns the number of apples eaten in the game of the passed instance,
+ * the snake's counterpart of removed lines.
+ *
+ * @param game Game handle
+ *
+ * @return Number of apples
+ */
+int gameLines(Game_t *game) { return game->prms.stats.score; }
+
+/**
+ * @brief Game set planning
+ *
+ * The autopilot of the snake has no planning mode, its cycle never
+ * loses anyway.
+ *
+ * @param game Game handle
+ * @param config Plan config struct or NULL
+ *
+ * @return -1, not supported
+ */
+int gameSetPlanning(Game_t *game, const PlanConfig_t *config) {
+  (void)game;
+  (void)config;
+  return -1;
+}
+
+/**
+ * @brief Destroy game
+ *
+ * Frees the game instance and all of its memory.
+ *
+ * @param game Game handle
+ */
+void gameDestroy(Game_t *game) {
+  if (game) {
+    game->model.freeMem();
+    delete game;
+  }
 }
 
 /**
@@ -65,6 +326,59 @@ void s21::SnakeModel::fsm() {
   }
 }
 
+/**
+ * @brief Is transient
+ *
+ * Tells if the current state passes on by itself, without input.
+ *
+ * @return Whether the state is transient
+ */
+bool s21::SnakeModel::isTransient() const {
+  return this->prms->state == SPAWN || this->prms->state == SHIFTING ||
+         this->prms->state == GAMEOVER || this->prms->state == GAMEOVERWON;
+}
+
+/**
+ * @brief Is repeatable
+ *
+ * Tells if the action repeats while held: only acceleration does, so a
+ * held key keeps the snake fast. Turns are never repeated.
+ *
+ * @param action User action enum
+ *
+ * @return Whether the action is repeatable
+ */
+bool s21::SnakeModel::isRepeatable(UserAction_t action) {
+  return action == Action;
+}
+
+/**
+ * @brief Auto repeat
+ *
+ * Repeats the held action at each of its deadlines which has come.
+ * Repeats are only applied while the snake is moving, the ones which
+ * come in other states are skipped.
+ *
+ * @return Number of applied repeats
+ */
+int s21::SnakeModel::autoRepeat() {
+  Repeat_t &repeat = this->prms->repeat;
+  int repeats = 0;
+
+  while (repeat.active && repeat.next_at <= this->prms->now) {
+    if (this->prms->state == MOVING) {
+      setSignal(repeat.action);
+      fsm();
+      setSignal(Up);
+      repeat.next_at += repeat.interval;
+      ++repeats;
+    } else {
+      repeat.next_at = this->prms->now + repeat.interval;
+    }
+  }
+  return repeats;
+}
+
 /**
  * @brief Start state
  *
@@ -90,22 +404,30 @@ void s21::SnakeModel::start() {
 /**
  * @brief Stats init
  *
- * Initializes score, level, speed, ticks, clears the field on new game,
- * sets rand(), reads highscore from file and spawns snake.
+ * Initializes score, level, speed, schedules the first move, clears the
+ * field on new game, seeds the game's random generator on the first game,
+ * remembers the generator state the game starts with, reads highscore
+ * from file and spawns snake.
+ *
+ * The seed is taken from params or from the current time if it's 0.
+ * Later games continue the same random sequence.
  */
 void s21::SnakeModel::statsInit() {
   this->prms->stats.score = 0;
   this->prms->stats.level = 1;
   this->prms->stats.speed = 1;
-  this->prms->ticks = 0;
+  this->prms->step_at = this->prms->now + stepInterval();
+  this->prms->started_at = this->prms->now;
 
   if (this->prms->stats.pause == GAMELOST ||
       this->prms->stats.pause == GAMEWON) {
     clearField();
   } else {
-    srand(time(NULL));
+    rngSeed(&this->prms->rng,
+            this->prms->seed ? this->prms->seed : (uint64_t)time(NULL));
   }
   this->prms->stats.pause = PLAYING;
+  this->prms->game_seed = this->prms->rng.state;
 
   getHighScore();
   spawnSnake();
@@ -117,46 +439,36 @@ void s21::SnakeModel::statsInit() {
  * Clears the game field.
  */
 void s21::SnakeModel::clearField() {
-  for (int i = 0; i < FIELD_HEIGHT; i++) {
-    for (int j = 0; j < FIELD_WIDTH; j++) {
-      this->prms->stats.field[i][j] = 0;
-    }
-  }
+  std::fill_n(this->prms->stats.field[0], FIELD_HEIGHT * FIELD_WIDTH, 0);
+  this->prms->board_changed = true;
 }
 
 /**
  * @brief Get highscore
  *
- * Opens a file and reads highscore.
+ * Takes highscore from the high score store, which reads it from file
+ * only once.
  */
 void s21::SnakeModel::getHighScore() {
-  std::ifstream fp;
-  fp.open("brick_game/snake/high_score.txt");
-  if (!fp.is_open()) {
-    fp.open("../../../brick_game/snake/high_score.txt");
-  }
-
-  if (fp.is_open()) {
-    fp >> this->prms->stats.high_score;
-    fp.close();
-  } else {
-    this->prms->stats.high_score = 0;
-  }
+  this->prms->stats.high_score = highScoreLoad(HIGH_SCORE_PATH);
 }
 
 /**
  * @brief Spawn snake
  *
- * Spawns a snake.
+ * Spawns a snake. The hash starts over from the apple, which is still
+ * where the last game has left it.
  */
 void s21::SnakeModel::spawnSnake() {
   this->prms->direction = LOOKUP;
   this->prms->body->setSize(0);
+  this->prms->free_cells.reset();
+  this->prms->hash = appleHash();
 
-  this->prms->stats.field[9][5] = 1;
-  this->prms->stats.field[10][5] = 1;
-  this->prms->stats.field[11][5] = 1;
-  this->prms->stats.field[12][5] = 1;
+  occupy(5, 9);
+  occupy(5, 10);
+  occupy(5, 11);
+  occupy(5, 12);
 
   this->prms->body->push(5, 12);
   this->prms->body->push(5, 11);
@@ -184,18 +496,95 @@ void s21::SnakeModel::spawnApple() { findEmptySpace(); }
 /**
  * @brief Find empty space
  *
- * Finds an unoccupied cell to spawn an apple into.
+ * Finds an unoccupied cell to spawn an apple into with a single draw
+ * from the free cells index. If the snake fills the whole field,
+ * no apple is spawned.
  */
 void s21::SnakeModel::findEmptySpace() {
-  this->prms->apple.x = rand() % 10;
-  this->prms->apple.y = rand() % 20;
-
-  while (this->prms->stats.field[prms->apple.y][prms->apple.x] == 1) {
-    this->prms->apple.x = rand() % 10;
-    this->prms->apple.y = rand() % 20;
+  this->prms->hash ^= appleHash();
+  if (this->prms->free_cells.size() > 0) {
+    FreeCells &free_cells = this->prms->free_cells;
+    int cell = free_cells.at(rngBounded(&this->prms->rng, free_cells.size()));
+
+    this->prms->apple.x = cell % FIELD_WIDTH;
+    this->prms->apple.y = cell / FIELD_WIDTH;
+    this->prms->stats.field[prms->apple.y][prms->apple.x] = 2;
+    this->prms->board_changed = true;
+  } else {
+    this->prms->apple.x = -1;
+    this->prms->apple.y = -1;
   }
+  this->prms->hash ^= appleHash();
+}
 
-  this->prms->stats.field[prms->apple.y][prms->apple.x] = 2;
+/**
+ * @brief Occupy
+ *
+ * Puts a snake segment into a cell of the field and takes the cell
+ * from the free cells index.
+ *
+ * @param x X coordinate
+ * @param y Y coordinate
+ */
+void s21::SnakeModel::occupy(int x, int y) {
+  this->prms->hash ^= zobristKey(y * FIELD_WIDTH + x);
+  this->prms->stats.field[y][x] = 1;
+  this->prms->free_cells.take(x, y);
+  this->prms->board_changed = true;
+}
+
+/**
+ * @brief Vacate
+ *
+ * Clears a cell of the field and returns it to the free cells index.
+ *
+ * @param x X coordinate
+ * @param y Y coordinate
+ */
+void s21::SnakeModel::vacate(int x, int y) {
+  this->prms->hash ^= zobristKey(y * FIELD_WIDTH + x);
+  this->prms->stats.field[y][x] = 0;
+  this->prms->free_cells.release(x, y);
+  this->prms->board_changed = true;
+}
+
+/**
+ * @brief Apple hash
+ *
+ * Returns the key of the apple's cell. The top left cell has the key 0,
+ * so that fresh params, with the apple there, hash to 0. No apple has
+ * a key of its own.
+ *
+ * @return Key
+ */
+uint64_t s21::SnakeModel::appleHash() const {
+  const Apple_t &apple = this->prms->apple;
+  uint64_t hash = zobristKey(2 * ZOBRIST_CELLS);
+
+  if (apple.x >= 0)
+    hash = apple.x == 0 && apple.y == 0
+               ? 0
+               : zobristKey(ZOBRIST_CELLS + apple.y * FIELD_WIDTH + apple.x);
+  return hash;
+}
+
+/**
+ * @brief Hash state
+ *
+ * Computes the hash of the position from scratch: the keys of all
+ * cells of the snake's body and of the apple. The incrementally kept
+ * hash always equals it.
+ *
+ * @return Hash
+ */
+uint64_t s21::SnakeModel::hashState() const {
+  uint64_t hash = appleHash();
+
+  for (int i = 0; i < this->prms->body->getSize(); i++) {
+    SnakeBody::Node node = this->prms->body->getNode(i);
+    hash ^= zobristKey(node.y * FIELD_WIDTH + node.x);
+  }
+  return hash;
 }
 
 /**
@@ -204,14 +593,17 @@ void s21::SnakeModel::findEmptySpace() {
  * In this state the snake can be moved and accelerated. If action button is
  * pressed, accelerates the snake. The snake can also be moved left and right.
  * A pause button can be pressed to pause the game. Or a terminate
- * button can be pressed to exit the game. By default increases game ticks
- * and switches the state to SHIFTING if enough ticks were passed.
+ * button can be pressed to exit the game. By default switches the state
+ * to SHIFTING when the deadline of the next move has come.
+ *
+ * Acceleration moves the snake at once and schedules the next move
+ * a full interval later.
  */
 void s21::SnakeModel::moving() {
   switch (this->prms->signal) {
     case Action:
       this->prms->state = SHIFTING;
-      this->prms->ticks = 0;
+      this->prms->step_at = this->prms->now + stepInterval();
       break;
     case Left:
       turnLeft();
@@ -230,14 +622,39 @@ void s21::SnakeModel::moving() {
       break;
 
     default:
-      this->prms->ticks++;
-      if (prms->ticks >= INITIAL_TIMEOUT * 0.5 / (prms->stats.speed * 0.1)) {
+      if (this->prms->now >= this->prms->step_at) {
         this->prms->state = SHIFTING;
-        this->prms->ticks = 0;
+        nextStep();
       }
   }
 }
 
+/**
+ * @brief Step interval
+ *
+ * Time between two moves of the snake at the current speed, half of
+ * the tetris gravity interval.
+ *
+ * @return Interval in milliseconds
+ */
+int s21::SnakeModel::stepInterval() {
+  return INITIAL_TIMEOUT / 2 / this->prms->stats.speed;
+}
+
+/**
+ * @brief Next step
+ *
+ * Moves the deadline of the next move one interval forward, so the snake
+ * keeps a fixed rate however often the game is updated. If the game is
+ * late by more than an interval, the backlog is dropped instead of being
+ * caught up.
+ */
+void s21::SnakeModel::nextStep() {
+  this->prms->step_at += stepInterval();
+  if (this->prms->step_at < this->prms->now)
+    this->prms->step_at = this->prms->now;
+}
+
 /**
  * @brief Turn left
  *
@@ -296,19 +713,19 @@ void s21::SnakeModel::turnRight() {
  * the game state to GAMEOVERWON. Otherwise MOVING state is set.
  */
 void s21::SnakeModel::shifting() {
-  int temp_x = this->prms->body->getTail()->x;
-  int temp_y = this->prms->body->getTail()->y;
+  int temp_x = this->prms->body->getTail().x;
+  int temp_y = this->prms->body->getTail().y;
   clearTail();
 
   if (moveForward()) {
     this->prms->body->pushBack(temp_x, temp_y);
-    this->prms->stats.field[temp_y][temp_x] = 1;
+    occupy(temp_x, temp_y);
 
     this->prms->state = GAMEOVER;
   } else {
     if (eatApple()) {
       this->prms->body->pushBack(temp_x, temp_y);
-      this->prms->stats.field[temp_y][temp_x] = 1;
+      occupy(temp_x, temp_y);
 
       this->prms->state = SPAWN;
     } else {
@@ -323,46 +740,41 @@ void s21::SnakeModel::shifting() {
  * @brief Move forward
  *
  * Moves the snake forward depending on the direction it's looking.
- * A new snake body node is pushed to the snake's head and
- * a node is popped from the snake's tail.
+ * A new snake body node is pushed to the snake's head.
  *
- * If the snake encounters a wall or its own body, the game ends.
+ * If the snake encounters a wall or its own body, the game ends
+ * and the head stays where it was.
  *
  * @return Crash status
  */
 int s21::SnakeModel::moveForward() {
+  SnakeBody::Node head = this->prms->body->getHead();
+
   switch (this->prms->direction) {
     case LOOKLEFT:
-      this->prms->body->push(this->prms->body->getHead()->x - 1,
-                             this->prms->body->getHead()->y);
+      --head.x;
       break;
 
     case LOOKUP:
-      this->prms->body->push(this->prms->body->getHead()->x,
-                             this->prms->body->getHead()->y - 1);
+      --head.y;
       break;
 
     case LOOKRIGHT:
-      this->prms->body->push(this->prms->body->getHead()->x + 1,
-                             this->prms->body->getHead()->y);
+      ++head.x;
       break;
 
     case LOOKDOWN:
-      this->prms->body->push(this->prms->body->getHead()->x,
-                             this->prms->body->getHead()->y + 1);
+      ++head.y;
   }
 
   int game_over = 0;
-  if (this->prms->body->getHead()->x < 0 ||
-      this->prms->body->getHead()->x >= FIELD_WIDTH ||
-      this->prms->body->getHead()->y < 0 ||
-      this->prms->body->getHead()->y >= FIELD_HEIGHT ||
-      this->prms->stats
-              .field[prms->body->getHead()->y][prms->body->getHead()->x] == 1)
+  if (head.x < 0 || head.x >= FIELD_WIDTH || head.y < 0 ||
+      head.y >= FIELD_HEIGHT || this->prms->stats.field[head.y][head.x] == 1)
     game_over = 1;
-  else
-    this->prms->stats
-        .field[prms->body->getHead()->y][prms->body->getHead()->x] = 1;
+  else {
+    this->prms->body->push(head.x, head.y);
+    occupy(head.x, head.y);
+  }
 
   return game_over;
 }
@@ -370,14 +782,16 @@ int s21::SnakeModel::moveForward() {
 /**
  * @brief Check game won
  *
- * Defines if the snake has eaten 200 apples or not. If it has,
+ * Defines if the snake has eaten 200 apples or filled the whole field,
+ * which comes first as the snake starts with 4 segments. If it has,
  * the game won status is returned.
  *
  * @return Game won status
  */
 int s21::SnakeModel::checkGameWon() {
   int game_won = 0;
-  if (this->prms->stats.score == 200) game_won = 1;
+  if (this->prms->stats.score == 200 || this->prms->free_cells.size() == 0)
+    game_won = 1;
 
   return game_won;
 }
@@ -393,8 +807,9 @@ int s21::SnakeModel::checkGameWon() {
  */
 int s21::SnakeModel::eatApple() {
   int ate_apple = 0;
-  if (this->prms->body->getHead()->x == this->prms->apple.x &&
-      this->prms->body->getHead()->y == this->prms->apple.y) {
+  SnakeBody::Node head = this->prms->body->getHead();
+
+  if (head.x == this->prms->apple.x && head.y == this->prms->apple.y) {
     this->prms->stats.score += 1;
 
     if (this->prms->stats.score > this->prms->stats.high_score) {
@@ -425,9 +840,9 @@ void s21::SnakeModel::increaseLevel() {
  * Pops the snake's tail and changes the tail's coordinates.
  */
 void s21::SnakeModel::clearTail() {
-  this->prms->stats
-      .field[this->prms->body->getTail()->y][this->prms->body->getTail()->x] =
-      0;
+  SnakeBody::Node tail = this->prms->body->getTail();
+
+  vacate(tail.x, tail.y);
   this->prms->body->pop();
 }
 
@@ -437,6 +852,7 @@ void s21::SnakeModel::clearTail() {
  * Pauses and unpauses the game.
  *
  * The game starts with this state, the memory is also allocated here.
+ * On resume the next move is scheduled a full interval ahead.
  */
 void s21::SnakeModel::pause() {
   if (this->prms->stats.field == NULL && this->prms->stats.pause == STARTING) {
@@ -448,13 +864,14 @@ void s21::SnakeModel::pause() {
       if (this->prms->stats.pause == STARTING) {
         this->prms->state = START;
         this->prms->stats.pause = PLAYING;
-        Snake.fsm();
+        fsm();
       }
       break;
 
     case Pause:
       this->prms->state = MOVING;
       this->prms->stats.pause = PLAYING;
+      this->prms->step_at = this->prms->now + stepInterval();
       break;
 
     case Terminate:
@@ -470,11 +887,16 @@ void s21::SnakeModel::pause() {
  * @brief Allocate memory
  *
  * Allocates memory for the field.
+ *
+ * All cells are allocated as one contiguous block and the field rows
+ * point into it, so the first row is also a flat view of the whole field.
  */
 void s21::SnakeModel::memAlloc() {
-  this->prms->stats.field = new int *[FIELD_HEIGHT]();
+  int *cells = new int[FIELD_HEIGHT * FIELD_WIDTH]();
+
+  this->prms->stats.field = new int *[FIELD_HEIGHT];
   for (int i = 0; i < FIELD_HEIGHT; ++i) {
-    this->prms->stats.field[i] = new int[FIELD_WIDTH]();
+    this->prms->stats.field[i] = cells + i * FIELD_WIDTH;
   }
 }
 
@@ -492,21 +914,22 @@ void s21::SnakeModel::gameOver() {
 /**
  * @brief Save highscore
  *
- * Opens a file and saves current game's score if it's exceeded highscore.
+ * Hands current game's result to the high score store: its score
+ * becomes the highscore if it's exceeded it, and the result goes to
+ * the leaderboard, one apple per point. The store writes both to files
+ * on its own thread, so a game over never waits for the disk.
  */
 void s21::SnakeModel::saveHighScore() {
-  if (this->prms->stats.high_score == this->prms->stats.score &&
-      this->prms->stats.score > 0) {
-    std::ofstream fp;
-    fp.open("brick_game/snake/high_score.txt");
-    if (!fp.is_open()) {
-      fp.open("../../../brick_game/snake/high_score.txt");
-    }
-
-    if (fp.is_open()) {
-      fp << this->prms->stats.high_score;
-      fp.close();
-    }
+  if (this->prms->stats.score > 0) {
+    LeaderEntry_t entry{};
+
+    entry.score = this->prms->stats.score;
+    entry.level = this->prms->stats.level;
+    entry.count = this->prms->stats.score;
+    entry.duration = this->prms->now - this->prms->started_at;
+    entry.seed = this->prms->game_seed;
+    entry.timestamp = (int64_t)time(NULL);
+    highScoreRecord(&entry);
   }
 }
 
@@ -536,13 +959,11 @@ void s21::SnakeModel::exitState() {
 /**
  * @brief Free memory
  *
- * Frees allocated memory from current object.
+ * Frees allocated memory from current object. Already freed memory
+ * is skipped.
  */
 void s21::SnakeModel::freeMem() {
-  for (int i = 0; i < FIELD_HEIGHT; ++i) {
-    delete[] this->prms->stats.field[i];
-    this->prms->stats.field[i] = nullptr;
-  }
+  if (this->prms->stats.field) delete[] this->prms->stats.field[0];
 
   delete[] this->prms->stats.field;
   this->prms->stats.field = nullptr;
@@ -551,40 +972,103 @@ void s21::SnakeModel::freeMem() {
 /**
  * @brief Memory free
  *
- * Frees allocated memory. No object needed.
+ * Frees allocated memory of the default game. No object needed.
  */
-void memFree() {
-  GameInfo_t stats = getStats();
-
-  for (int i = 0; i < FIELD_HEIGHT; ++i) {
-    delete[] stats.field[i];
-    stats.field[i] = nullptr;
-  }
-
-  delete[] stats.field;
-  stats.field = nullptr;
-}
+void memFree() { default_game.model.freeMem(); }
 
 /**
  * @brief User input
  *
  * Accepts user's proccessed input into action.
  *
- * Updates current signal with new action.
+ * Updates current signal of the default game with new action.
  *
  * @param action User action enum
  * @param hold Is button held or not
  */
 void userInput(UserAction_t action, bool hold) {
-  (void)hold;
-  Snake.setSignal(action);
+  gameInput(&default_game, action, hold);
 }
 
 /**
  * @brief Get stats
  *
- * Returns updated Game info struct.
+ * Returns updated Game info struct of the default game.
  *
  * @return Game info struct
  */
-GameInfo_t getStats() { return Snake.getPrms().stats; }
+GameInfo_t getStats() { return gameSnapshot(&default_game); }
+
+/**
+ * @brief Get frame
+ *
+ * Returns a read-only view of the game info struct of the default game
+ * with its version and the parts changed after the seen version.
+ *
+ * @param seen Version the caller has seen, 0 if it hasn't seen any
+ *
+ * @return Game frame struct
+ */
+GameFrame_t getFrame(uint64_t seen) { return gameFrame(&default_game, seen); }
+
+/**
+ * @brief Get deadline
+ *
+ * Returns the time the default game has to be updated next.
+ *
+ * @return Time in milliseconds or NO_DEADLINE if the game waits for input
+ */
+int64_t getDeadline() { return gameDeadline(&default_game); }
+
+/**
+ * @brief Get dropped inputs
+ *
+ * Returns the number of actions the default game has dropped.
+ *
+ * @return Number of dropped actions
+ */
+uint64_t getDroppedInputs() { return gameDroppedInputs(&default_game); }
+
+/**
+ * @brief Set repeat
+ *
+ * Sets the delays of auto-repeat of the default game.
+ *
+ * @param delay Delay before the first repeat in milliseconds
+ * @param interval Delay between two repeats in milliseconds
+ */
+void setRepeat(int delay, int interval) {
+  gameSetRepeat(&default_game, delay, interval);
+}
+
+/**
+ * @brief Get autoplay
+ *
+ * Returns the action the autopilot makes in the default game now,
+ * to be passed to userInput().
+ *
+ * @return User action enum
+ */
+UserAction_t getAutoplay() { return gameAutoplay(&default_game); }
+
+/**
+ * @brief Get hash
+ *
+ * Returns the Zobrist hash of the position of the default game.
+ *
+ * @return Hash
+ */
+uint64_t getHash() { return gameHash(&default_game); }
+
+/**
+ * @brief Set planning
+ *
+ * The autopilot of the snake has no planning mode.
+ *
+ * @param config Plan config struct or NULL
+ *
+ * @return -1, not supported
+ */
+int setPlanning(const PlanConfig_t *config) {
+  return gameSetPlanning(&default_game, config);
+}
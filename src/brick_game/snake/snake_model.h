@@ -1,11 +1,20 @@
 #ifndef SNAKE_MODEL_H
 #define SNAKE_MODEL_H
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
-#include <fstream>
+#include <new>
 
 #include "../../common.h"
+#include "../common/high_score.h"
+#include "snake_bot.h"
+
+#ifndef HIGH_SCORE_PATH
+#define HIGH_SCORE_PATH "brick_game/snake/high_score.txt"
+#endif
 
 namespace s21 {
 
@@ -32,38 +41,51 @@ struct Apple_t {
  *
  * This class is used to create the body of the snake.
  *
- * It consists of structure Node, pointers to snake's head and tail,
- * snake's size and some functions to operate with the body.
+ * The body is a fixed-capacity ring buffer of packed cell coordinates
+ * (y * FIELD_WIDTH + x) big enough to cover the whole field, so moving
+ * the snake never allocates. Head and tail are accessed in O(1).
  */
 class SnakeBody {
- private:
+ public:
   /**
    * @brief Node structure
    *
-   * This structure contains coordinates of the node and the pointer
-   * to the next node.
+   * This structure contains coordinates of the node.
    *
    * A node is snake's body segment.
    */
   struct Node {
     int x;
     int y;
-    Node *next = nullptr;
   };
 
-  Node *tail = nullptr;
-  Node *head = nullptr;
+  static constexpr int kCapacity = FIELD_WIDTH * FIELD_HEIGHT;
+
+ private:
+  static_assert(kCapacity <= UINT8_MAX + 1, "cells must fit into uint8_t");
+
+  uint8_t cells[kCapacity]{};
+  int head = 0;
+  int tail = 0;
   int size = 0;
 
+  /**
+   * @brief Unpack
+   *
+   * Unpacks a cell into its coordinates.
+   *
+   * @param index Index of the cell in the ring buffer
+   *
+   * @return Node struct
+   */
+  Node unpack(int index) const {
+    return Node{this->cells[index] % FIELD_WIDTH,
+                this->cells[index] / FIELD_WIDTH};
+  }
+
  public:
   SnakeBody() {}
 
-  ~SnakeBody() {
-    while (this->size > 0) {
-      this->pop();
-    }
-  }
-
   /**
    * @brief Push
    *
@@ -73,18 +95,10 @@ class SnakeBody {
    * @param y Y coordinate
    */
   void push(int x, int y) {
-    Node *new_node = new Node;
-
-    if (this->size == 0) {
-      this->head = new_node;
-      this->tail = new_node;
-    } else {
-      this->head->next = new_node;
-      this->head = new_node;
-    }
+    this->head = (this->head + 1) % kCapacity;
+    if (this->size == 0) this->tail = this->head;
 
-    this->head->x = x;
-    this->head->y = y;
+    this->cells[this->head] = static_cast<uint8_t>(y * FIELD_WIDTH + x);
     ++this->size;
   }
 
@@ -97,14 +111,10 @@ class SnakeBody {
    * @param y Y coordinate
    */
   void pushBack(int x, int y) {
-    Node *new_node = new Node;
-
-    Node *temp = this->tail;
-    this->tail = new_node;
-    this->tail->next = temp;
+    this->tail = (this->tail + kCapacity - 1) % kCapacity;
+    if (this->size == 0) this->head = this->tail;
 
-    this->tail->x = x;
-    this->tail->y = y;
+    this->cells[this->tail] = static_cast<uint8_t>(y * FIELD_WIDTH + x);
     ++this->size;
   }
 
@@ -114,14 +124,7 @@ class SnakeBody {
    * Pops last node of the queue
    */
   void pop() {
-    if (this->size == 1) {
-      delete this->tail;
-    } else {
-      Node *tmp = this->tail;
-      this->tail = this->tail->next;
-      delete tmp;
-    }
-
+    this->tail = (this->tail + 1) % kCapacity;
     --this->size;
   }
 
@@ -132,7 +135,18 @@ class SnakeBody {
    *
    * @return Node struct
    */
-  Node *getHead() { return this->head; }
+  Node getHead() const { return unpack(this->head); }
+
+  /**
+   * @brief Get neck
+   *
+   * Returns the node right behind the head.
+   *
+   * @return Node struct
+   */
+  Node getNeck() const {
+    return unpack((this->head + kCapacity - 1) % kCapacity);
+  }
 
   /**
    * @brief Get tail
@@ -141,7 +155,29 @@ class SnakeBody {
    *
    * @return Node struct
    */
-  Node *getTail() { return this->tail; }
+  Node getTail() const { return unpack(this->tail); }
+
+  /**
+   * @brief Get node
+   *
+   * Returns a node of the snake counting from the tail.
+   *
+   * @param index Index of the node, less than the size
+   *
+   * @return Node struct
+   */
+  Node getNode(int index) const {
+    return unpack((this->tail + index) % kCapacity);
+  }
+
+  /**
+   * @brief Get size
+   *
+   * Returns current size of the snake.
+   *
+   * @return Number of nodes
+   */
+  int getSize() const { return this->size; }
 
   /**
    * @brief Set size
@@ -153,22 +189,129 @@ class SnakeBody {
   void setSize(int num) { this->size = num; }
 };
 
+/**
+ * @brief FreeCells class
+ *
+ * This class is an index of the cells not occupied by the snake.
+ *
+ * Free cells are kept packed in a dense array, and every cell knows its
+ * position in it, so a cell is taken or released in O(1) and a random
+ * free cell is a single draw, no matter how full the field is.
+ */
+class FreeCells {
+ public:
+  static constexpr int kCapacity = FIELD_WIDTH * FIELD_HEIGHT;
+
+ private:
+  uint8_t cells[kCapacity]{};
+  uint8_t position[kCapacity]{};
+  int count = 0;
+
+ public:
+  /**
+   * @brief Reset
+   *
+   * Marks every cell of the field as free.
+   */
+  void reset() {
+    for (int i = 0; i < kCapacity; ++i) {
+      this->cells[i] = static_cast<uint8_t>(i);
+      this->position[i] = static_cast<uint8_t>(i);
+    }
+    this->count = kCapacity;
+  }
+
+  /**
+   * @brief Take
+   *
+   * Removes a cell from the free ones, moving the last free cell
+   * into its place.
+   *
+   * @param x X coordinate
+   * @param y Y coordinate
+   */
+  void take(int x, int y) {
+    int cell = y * FIELD_WIDTH + x;
+    int last = this->cells[--this->count];
+
+    this->cells[this->position[cell]] = static_cast<uint8_t>(last);
+    this->position[last] = this->position[cell];
+    this->cells[this->count] = static_cast<uint8_t>(cell);
+    this->position[cell] = static_cast<uint8_t>(this->count);
+  }
+
+  /**
+   * @brief Release
+   *
+   * Adds a cell to the free ones.
+   *
+   * @param x X coordinate
+   * @param y Y coordinate
+   */
+  void release(int x, int y) {
+    int cell = y * FIELD_WIDTH + x;
+    int first_taken = this->cells[this->count];
+
+    this->cells[this->position[cell]] = static_cast<uint8_t>(first_taken);
+    this->position[first_taken] = this->position[cell];
+    this->cells[this->count] = static_cast<uint8_t>(cell);
+    this->position[cell] = static_cast<uint8_t>(this->count++);
+  }
+
+  /**
+   * @brief Size
+   *
+   * Returns the number of free cells.
+   *
+   * @return Number of free cells
+   */
+  int size() const { return this->count; }
+
+  /**
+   * @brief At
+   *
+   * Returns a free cell by its index.
+   *
+   * @param index Index less than size()
+   *
+   * @return Packed cell, y * FIELD_WIDTH + x
+   */
+  int at(int index) const { return this->cells[index]; }
+};
+
 /**
  * @brief Params struct
  *
  * The main structure which holds everything needed in the game.
  *
- * Contains game ticks, apple struct, game info struct, game state enum,
- * snake body class, look direction enum and user action enum.
+ * Contains current game time, the deadline of the next move and the start
+ * of the game in milliseconds, random seed, generator and its state at
+ * the start of the game, apple struct, free cells index, game info
+ * struct, game state enum, snake body class, look direction enum, user
+ * action enum, the queue of inputs not applied yet, auto-repeat of held
+ * actions, versions of the frames, whether the field has changed since
+ * the last one and the Zobrist hash of the snake's body and the apple,
+ * updated with every cell they take or leave.
  */
 struct Params_t {
-  int ticks = 0;
+  int64_t now = 0;
+  int64_t step_at = 0;
+  int64_t started_at = 0;
+  uint64_t seed = 0;
+  uint64_t game_seed = 0;
+  Rng_t rng{};
   Apple_t apple{};
+  FreeCells free_cells{};
   GameInfo_t stats{};
   GameState_t state = PAUSE;
   SnakeBody *body{};
   LookDirection_t direction = LOOKUP;
   UserAction_t signal = Up;
+  InputQueue_t inputs{};
+  Repeat_t repeat{0, false, Up, 0, REPEAT_DELAY, REPEAT_INTERVAL};
+  FrameTrack_t track{};
+  bool board_changed = false;
+  uint64_t hash = 0;
 
   Params_t(){};
 
@@ -185,6 +328,9 @@ struct Params_t {
 class SnakeModel {
  public:
   void fsm();
+  bool isTransient() const;
+  static bool isRepeatable(UserAction_t action);
+  int autoRepeat();
 
   void start();
   void statsInit();
@@ -195,12 +341,18 @@ class SnakeModel {
   void spawn();
   void spawnApple();
   void findEmptySpace();
+  void occupy(int x, int y);
+  void vacate(int x, int y);
+  uint64_t appleHash() const;
+  uint64_t hashState() const;
 
   void moving();
   void turnLeft();
   void turnRight();
 
   void shifting();
+  int stepInterval();
+  void nextStep();
   int moveForward();
   int checkGameWon();
   int eatApple();
@@ -247,4 +399,19 @@ class SnakeModel {
 
 }  // namespace s21
 
+/**
+ * @brief Game struct
+ *
+ * A single snake game instance behind the Game_t handle from common.h.
+ *
+ * Owns the snake body, params, the model operating them and
+ * the autopilot.
+ */
+struct Game {
+  s21::SnakeBody body{};
+  s21::Params_t prms{body};
+  s21::SnakeModel model{prms};
+  s21::SnakeBot bot{prms};
+};
+
 #endif
@@ -0,0 +1,391 @@
+#include "tetris_bot.h"
+
+#include "tetris_planner.h"
+
+/// @file
+const BotWeights_t bot_default_weights = {.height = -0.510066,
+                                          .lines = 0.760666,
+                                          .holes = -0.35663,
+                                          .bumpiness = -0.184483};
+
+/**
+ * @brief Game autoplay
+ *
+ * Returns the action the bot would make in the passed instance now:
+ * Start on a start screen or after a lost game, the next move towards
+ * the best placement of the moving figure, Up if there is nothing
+ * to do. The action is meant to be passed to gameInput(). In the planning
+ * mode set by gameSetPlanning() the placement is found by the lookahead
+ * search.
+ *
+ * @param game Game handle
+ *
+ * @return User action enum
+ */
+UserAction_t gameAutoplay(Game_t *game) {
+  return game->planner ? plan_action(game->planner, game)
+                       : bot_action(game, &bot_default_weights);
+}
+
+/**
+ * @brief Get autoplay
+ *
+ * Returns the action the bot would make in the default game now,
+ * to be passed to userInput().
+ *
+ * @return User action enum
+ */
+UserAction_t getAutoplay() { return gameAutoplay(get_params()); }
+
+/**
+ * @brief Bot action
+ *
+ * Chooses the next action of the bot: rotations come first, then lateral
+ * moves, then the drop. A blocked rotation is waited for. The best
+ * placement is chosen again before every action, so gravity and other
+ * inputs in between are taken into account.
+ *
+ * @param prms Params structure
+ * @param weights Bot weights struct
+ *
+ * @return User action enum
+ */
+UserAction_t bot_action(Params_t *prms, const BotWeights_t *weights) {
+  UserAction_t action = Up;
+  BotMove_t best;
+
+  if (prms->stats.pause == STARTING || prms->stats.pause == GAMELOST) {
+    action = Start;
+  } else if (prms->state == MOVING && prms->stats.pause == PLAYING &&
+             bot_best_move(prms, weights, &best)) {
+    action = bot_steer(prms, &best);
+  }
+
+  return action;
+}
+
+/**
+ * @brief Bot steer
+ *
+ * Returns the next action towards a placement: rotations come first,
+ * then lateral moves, then the drop. A blocked rotation is waited for.
+ *
+ * @param prms Params structure
+ * @param best Placement to reach
+ *
+ * @return User action enum
+ */
+UserAction_t bot_steer(Params_t *prms, const BotMove_t *best) {
+  UserAction_t action = Down;
+
+  if (best->rotation != prms->brick.rotation)
+    action = bot_rotation_free(prms) ? Action : Up;
+  else if (best->x < prms->brick.x)
+    action = Left;
+  else if (best->x > prms->brick.x)
+    action = Right;
+
+  return action;
+}
+
+/**
+ * @brief Bot best move
+ *
+ * Finds the reachable placement of the moving figure with the best
+ * evaluation. Of equal ones the first found is taken.
+ *
+ * @param prms Params structure
+ * @param weights Bot weights struct
+ * @param best Best placement
+ *
+ * @return Number of reachable placements, 0 if there is none
+ */
+int bot_best_move(Params_t *prms, const BotWeights_t *weights,
+                  BotMove_t *best) {
+  BotMove_t moves[BOT_MAX_MOVES];
+  int count = bot_moves(prms, weights, moves);
+
+  for (int i = 0; i < count; i++) {
+    if (i == 0 || moves[i].score > best->score) *best = moves[i];
+  }
+  return count;
+}
+
+/**
+ * @brief Bot moves
+ *
+ * Enumerates every final placement the moving figure can reach the way
+ * the bot plays: rotations, then lateral moves, then a drop. A rotation
+ * which is blocked where the figure is now is made as soon as gravity
+ * has brought the figure low enough. Works on a scratch copy of
+ * the board and the brick, the game itself isn't changed.
+ *
+ * @param prms Params structure
+ * @param weights Bot weights struct
+ * @param moves Array of BOT_MAX_MOVES placements to fill
+ *
+ * @return Number of placements
+ */
+int bot_moves(Params_t *prms, const BotWeights_t *weights, BotMove_t *moves) {
+  Params_t scratch;
+  int rotations = prms->brick.piece == O_PIECE ? 1 : BRICK_ROTATIONS;
+  int count = 0;
+
+  bot_scratch(&scratch, &prms->brick, prms->board);
+  bot_lift(&scratch);
+  Brick_t start = scratch.brick;
+  for (int turns = 0; turns < rotations; turns++) {
+    scratch.brick = start;
+    if (bot_rotate(&scratch, turns)) {
+      count += bot_slide(&scratch, -1, weights, moves + count);
+      count += bot_slide(&scratch, 1, weights, moves + count);
+    }
+  }
+
+  return count;
+}
+
+/**
+ * @brief Bot rotate
+ *
+ * Rotates the figure clockwise the given number of times at the highest
+ * row from its own one down where none of the rotations collides.
+ *
+ * @param scratch Scratch params structure
+ * @param turns Number of rotations
+ *
+ * @return 1 if there is such a row, 0 if the figure lands before it
+ */
+int bot_rotate(Params_t *scratch, int turns) {
+  Brick_t start = scratch->brick;
+  int rotated = 0;
+  int blocked = check_collision(scratch);
+
+  while (!rotated && !blocked) {
+    rotated = 1;
+    for (int i = 0; rotated && i < turns; i++) {
+      rotate_brick(scratch);
+      rotated = !check_collision(scratch);
+    }
+    if (!rotated) {
+      start.y++;
+      scratch->brick = start;
+      blocked = check_collision(scratch);
+    }
+  }
+
+  return rotated;
+}
+
+/**
+ * @brief Bot rotation free
+ *
+ * Tells if the figure can be rotated where it is now.
+ *
+ * @param prms Params structure
+ *
+ * @return 1 if the rotation doesn't collide, 0 otherwise
+ */
+int bot_rotation_free(Params_t *prms) {
+  Params_t scratch;
+
+  bot_scratch(&scratch, &prms->brick, prms->board);
+  bot_lift(&scratch);
+  rotate_brick(&scratch);
+
+  return !check_collision(&scratch);
+}
+
+/**
+ * @brief Bot scratch
+ *
+ * Sets up a scratch params structure for the bot: a copy of the brick
+ * and of the board, everything else zeroed. The bot only moves the brick
+ * and changes the board of a scratch, it never goes through the game
+ * state functions which keep the hash and the state of a game.
+ *
+ * @param scratch Scratch params structure
+ * @param brick Brick struct
+ * @param board Board rows
+ */
+void bot_scratch(Params_t *scratch, const Brick_t *brick,
+                 const uint16_t *board) {
+  memset(scratch, 0, sizeof(Params_t));
+  scratch->brick = *brick;
+  memcpy(scratch->board, board, sizeof(scratch->board));
+}
+
+/**
+ * @brief Bot lift
+ *
+ * Takes the figure off the scratch board, if it has been placed there.
+ * A just spawned figure isn't on the board yet.
+ *
+ * @param scratch Scratch params structure
+ */
+void bot_lift(Params_t *scratch) {
+  int placed = 1;
+
+  for (int i = 0; i < BRICK_SIDE; i++) {
+    int y = i + scratch->brick.y;
+    uint16_t row = brick_row(scratch, i);
+
+    if (row && y >= 0 && y < FIELD_HEIGHT && (scratch->board[y] & row) != row)
+      placed = 0;
+  }
+  for (int i = 0; placed && i < BRICK_SIDE; i++) {
+    int y = i + scratch->brick.y;
+
+    if (y >= 0 && y < FIELD_HEIGHT) scratch->board[y] &= ~brick_row(scratch, i);
+  }
+}
+
+/**
+ * @brief Bot drop
+ *
+ * Drops the figure on the scratch board as far as it goes, from a row
+ * where it doesn't collide.
+ *
+ * @param scratch Scratch params structure
+ */
+void bot_drop(Params_t *scratch) {
+  while (!check_collision(scratch)) scratch->brick.y++;
+  scratch->brick.y--;
+}
+
+/**
+ * @brief Bot slide
+ *
+ * Moves the figure step by step in one direction until it collides and
+ * drops it from every column on the way. Sliding to the left starts at
+ * the figure's own column, sliding to the right one column next to it.
+ *
+ * @param scratch Scratch params structure
+ * @param dx Direction of the moves, -1 or 1
+ * @param weights Bot weights struct
+ * @param moves Placements to fill
+ *
+ * @return Number of placements
+ */
+int bot_slide(Params_t *scratch, int dx, const BotWeights_t *weights,
+              BotMove_t *moves) {
+  Brick_t start = scratch->brick;
+  int count = 0;
+
+  if (dx > 0) scratch->brick.x += dx;
+  while (!check_collision(scratch)) {
+    Brick_t column = scratch->brick;
+
+    bot_drop(scratch);
+    moves[count].rotation = column.rotation;
+    moves[count].x = column.x;
+    moves[count].y = scratch->brick.y;
+    moves[count].score = bot_evaluate(scratch, weights);
+    count++;
+    scratch->brick = column;
+    scratch->brick.x += dx;
+  }
+  scratch->brick = start;
+
+  return count;
+}
+
+/**
+ * @brief Bot evaluate
+ *
+ * Evaluates the board the dropped figure leaves: lands it on a copy
+ * of the scratch board and weights the features of the result.
+ *
+ * @param scratch Scratch params structure with the dropped figure
+ * @param weights Bot weights struct
+ *
+ * @return Evaluation, the higher the better
+ */
+double bot_evaluate(Params_t *scratch, const BotWeights_t *weights) {
+  uint16_t board[FIELD_HEIGHT];
+  BotFeatures_t features;
+  int lines = bot_land(scratch, board);
+
+  bot_features(board, lines, &features);
+  return bot_score(&features, weights);
+}
+
+/**
+ * @brief Bot land
+ *
+ * Places the dropped figure on a copy of the scratch board and removes
+ * complete lines from it.
+ *
+ * @param scratch Scratch params structure with the dropped figure
+ * @param board Board rows to fill
+ *
+ * @return Number of lines removed
+ */
+int bot_land(Params_t *scratch, uint16_t *board) {
+  int bottom = FIELD_HEIGHT - 1;
+  int lines = 0;
+
+  memcpy(board, scratch->board, sizeof(scratch->board));
+  for (int i = 0; i < BRICK_SIDE; i++) {
+    int y = i + scratch->brick.y;
+    if (y >= 0 && y < FIELD_HEIGHT) board[y] |= brick_row(scratch, i);
+  }
+  for (int i = FIELD_HEIGHT - 1; i >= 0; i--) {
+    if (board[i] == FIELD_ROW_FULL)
+      lines++;
+    else
+      board[bottom--] = board[i];
+  }
+  while (bottom >= 0) board[bottom--] = 0;
+
+  return lines;
+}
+
+/**
+ * @brief Bot features
+ *
+ * Computes the features of a board in one pass from the top row down:
+ * a column's height is taken from its first filled cell, every empty
+ * cell under a filled one is a hole.
+ *
+ * @param board Board rows, without complete ones
+ * @param lines Lines removed by the placement
+ * @param features Bot features struct
+ */
+void bot_features(const uint16_t *board, int lines, BotFeatures_t *features) {
+  int heights[FIELD_WIDTH] = {0};
+  unsigned seen = 0;
+
+  features->height = 0;
+  features->lines = lines;
+  features->holes = 0;
+  features->bumpiness = 0;
+  for (int i = 0; i < FIELD_HEIGHT; i++) {
+    unsigned fresh = board[i] & ~seen;
+
+    features->holes += __builtin_popcount(seen & ~board[i] & FIELD_ROW_FULL);
+    for (; fresh; fresh &= fresh - 1)
+      heights[__builtin_ctz(fresh)] = FIELD_HEIGHT - i;
+    seen |= board[i];
+  }
+  for (int j = 0; j < FIELD_WIDTH; j++) {
+    features->height += heights[j];
+    if (j > 0) features->bumpiness += abs(heights[j] - heights[j - 1]);
+  }
+}
+
+/**
+ * @brief Bot score
+ *
+ * Weights the features of a board.
+ *
+ * @param features Bot features struct
+ * @param weights Bot weights struct
+ *
+ * @return Evaluation, the higher the better
+ */
+double bot_score(const BotFeatures_t *features, const BotWeights_t *weights) {
+  return weights->height * features->height +
+         weights->lines * features->lines + weights->holes * features->holes +
+         weights->bumpiness * features->bumpiness;
+}
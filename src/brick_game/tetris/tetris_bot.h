@@ -0,0 +1,70 @@
+#ifndef TETRIS_BOT_H
+#define TETRIS_BOT_H
+
+/// @file
+#include "tetris_model.h"
+
+#define BOT_MAX_MOVES (BRICK_ROTATIONS * (FIELD_WIDTH + BRICK_SIDE))
+
+/**
+ * @brief Bot weights struct
+ *
+ * Weights of the board features in the evaluation of a placement:
+ * aggregate height of the columns, lines removed by the placement, holes
+ * under the column tops and bumpiness, the sum of height differences
+ * of neighbouring columns.
+ */
+typedef struct {
+  double height;
+  double lines;
+  double holes;
+  double bumpiness;
+} BotWeights_t;
+
+/**
+ * @brief Bot features struct
+ *
+ * Features of the board after a placement, the ones weighted by
+ * the bot weights struct.
+ */
+typedef struct {
+  int height;
+  int lines;
+  int holes;
+  int bumpiness;
+} BotFeatures_t;
+
+/**
+ * @brief Bot move struct
+ *
+ * A final placement of the current figure: its rotation and column,
+ * the row it lands on and the evaluation of the board after it.
+ */
+typedef struct {
+  int rotation;
+  int x;
+  int y;
+  double score;
+} BotMove_t;
+
+extern const BotWeights_t bot_default_weights;
+
+UserAction_t bot_action(Params_t *prms, const BotWeights_t *weights);
+UserAction_t bot_steer(Params_t *prms, const BotMove_t *best);
+int bot_best_move(Params_t *prms, const BotWeights_t *weights,
+                  BotMove_t *best);
+int bot_moves(Params_t *prms, const BotWeights_t *weights, BotMove_t *moves);
+int bot_rotate(Params_t *scratch, int turns);
+int bot_rotation_free(Params_t *prms);
+void bot_scratch(Params_t *scratch, const Brick_t *brick,
+                 const uint16_t *board);
+void bot_lift(Params_t *scratch);
+void bot_drop(Params_t *scratch);
+int bot_slide(Params_t *scratch, int dx, const BotWeights_t *weights,
+              BotMove_t *moves);
+double bot_evaluate(Params_t *scratch, const BotWeights_t *weights);
+int bot_land(Params_t *scratch, uint16_t *board);
+void bot_features(const uint16_t *board, int lines, BotFeatures_t *features);
+double bot_score(const BotFeatures_t *features, const BotWeights_t *weights);
+
+#endif
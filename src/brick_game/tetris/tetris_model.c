@@ -1,16 +1,64 @@
 #include "tetris_model.h"
 
+#include "tetris_planner.h"
+
 /// @file
+/**
+ * @brief Brick shapes
+ *
+ * Rows of the 4x4 matrix of every piece in every rotation state, clockwise
+ * from the spawn state. Bit j of a row is column j.
+ *
+ * The I piece rotates inside the whole 4x4 matrix, the others inside its
+ * top left 3x3 corner. The O piece doesn't rotate.
+ */
+const uint8_t brick_shapes[BRICK_PIECES][BRICK_ROTATIONS][BRICK_SIDE] = {
+    [I_PIECE] = {{0x0, 0xF, 0x0, 0x0},
+                 {0x4, 0x4, 0x4, 0x4},
+                 {0x0, 0x0, 0xF, 0x0},
+                 {0x2, 0x2, 0x2, 0x2}},
+    [J_PIECE] = {{0x0, 0x7, 0x4, 0x0},
+                 {0x2, 0x2, 0x3, 0x0},
+                 {0x1, 0x7, 0x0, 0x0},
+                 {0x6, 0x2, 0x2, 0x0}},
+    [L_PIECE] = {{0x0, 0x7, 0x1, 0x0},
+                 {0x3, 0x2, 0x2, 0x0},
+                 {0x4, 0x7, 0x0, 0x0},
+                 {0x2, 0x2, 0x6, 0x0}},
+    [O_PIECE] = {{0x0, 0x6, 0x6, 0x0},
+                 {0x0, 0x6, 0x6, 0x0},
+                 {0x0, 0x6, 0x6, 0x0},
+                 {0x0, 0x6, 0x6, 0x0}},
+    [S_PIECE] = {{0x0, 0x6, 0x3, 0x0},
+                 {0x1, 0x3, 0x2, 0x0},
+                 {0x6, 0x3, 0x0, 0x0},
+                 {0x2, 0x6, 0x4, 0x0}},
+    [T_PIECE] = {{0x0, 0x7, 0x2, 0x0},
+                 {0x2, 0x3, 0x2, 0x0},
+                 {0x2, 0x7, 0x0, 0x0},
+                 {0x2, 0x6, 0x2, 0x0}},
+    [Z_PIECE] = {{0x0, 0x3, 0x6, 0x0},
+                 {0x2, 0x3, 0x1, 0x0},
+                 {0x3, 0x6, 0x0, 0x0},
+                 {0x4, 0x6, 0x2, 0x0}},
+};
+
 /**
  * @brief Get params
  *
  * Declares a static params struct one time and returns it
  * every time this function is called.
  *
+ * This is the default game instance used by the functions
+ * from common.h which don't take a game handle.
+ *
  * @return Params structure
  */
 Params_t *get_params() {
-  static Params_t prms = {.state = PAUSE, .signal = Up};
+  static Params_t prms = {
+      .state = PAUSE,
+      .signal = Up,
+      .repeat = {.delay = REPEAT_DELAY, .interval = REPEAT_INTERVAL}};
 
   return &prms;
 }
@@ -18,17 +66,268 @@ Params_t *get_params() {
 /**
  * @brief Update current state
  *
- * Updates game state and clears the signal.
+ * Updates default game state and clears the signal.
  *
  * @return Game info structure
  */
 GameInfo_t updateCurrentState() {
   Params_t *prms = get_params();
 
-  fsm(prms);
-  prms->signal = Up;
+  gameStep(prms);
+
+  return gameSnapshot(prms);
+}
+
+/**
+ * @brief Create game
+ *
+ * Allocates a new independent game instance together with its field
+ * and figure. The game starts in the starting screen, like the default one.
+ *
+ * @param seed Seed of the game's random numbers, 0 for a time-based one
+ *
+ * @return Game handle or NULL if allocation failed
+ */
+Game_t *gameCreate(uint64_t seed) {
+  Params_t *prms = calloc(1, sizeof(Params_t));
+
+  if (prms) {
+    prms->seed = seed;
+    prms->state = PAUSE;
+    prms->signal = Up;
+    repeatSet(&prms->repeat, REPEAT_DELAY, REPEAT_INTERVAL);
+    if (mem_alloc(prms)) {
+      free(prms);
+      prms = NULL;
+    }
+  }
+  return prms;
+}
+
+/**
+ * @brief Game step
+ *
+ * Updates game state of the passed instance at the current time
+ * of the monotonic clock.
+ *
+ * @param game Game handle
+ */
+void gameStep(Game_t *game) { gameStepAt(game, gameTime()); }
+
+/**
+ * @brief Game step at
+ *
+ * Updates game state of the passed instance at the passed time. Every
+ * queued input which has to be applied gets its own FSM step in the
+ * order it was made; between two inputs the states which pass on by
+ * themselves are run through, so that no input lands in a state which
+ * ignores it. Then the held action is repeated, if it is due. Without
+ * any of them the FSM is stepped once. A step which changes what views
+ * show makes a new frame version. The time must not go backwards.
+ *
+ * @param game Game handle
+ * @param now Current time in milliseconds
+ */
+void gameStepAt(Game_t *game, int64_t now) {
+  uint16_t board[FIELD_HEIGHT];
+  Input_t input;
+  int stepped = 0;
+
+  memcpy(board, game->board, sizeof(board));
+  game->now = now;
+  while (inputPop(&game->inputs, &input)) {
+    if (repeatInput(&game->repeat, input, repeatable(input.action))) {
+      while (stepped && transient_state(game)) fsm(game);
+      game->signal = input.action;
+      fsm(game);
+      game->signal = Up;
+      stepped = 1;
+    }
+  }
+  if (auto_repeat(game) == 0 && !stepped) fsm(game);
+  HASH_CHECK(game->hash, board_hash(game));
+
+  frameTrack(&game->track, &game->stats,
+             memcmp(board, game->board, sizeof(board)) != 0);
+}
+
+/**
+ * @brief Game deadline
+ *
+ * Tells when the passed instance has to be stepped next, if no input
+ * comes earlier: at the next gravity step or repeat of the held action
+ * while the figure is moving, right away in the states which pass on
+ * by themselves or if there is queued input.
+ *
+ * @param game Game handle
+ *
+ * @return Time in milliseconds or NO_DEADLINE if the game waits for input
+ */
+int64_t gameDeadline(Game_t *game) {
+  int64_t deadline = game->now;
+
+  if (inputPending(&game->inputs))
+    deadline = game->now;
+  else if (game->state == MOVING && game->repeat.active)
+    deadline = game->repeat.next_at < game->step_at ? game->repeat.next_at
+                                                    : game->step_at;
+  else if (game->state == MOVING)
+    deadline = game->step_at;
+  else if (game->state == START || (game->state == PAUSE && game->stats.field))
+    deadline = NO_DEADLINE;
+
+  return deadline;
+}
+
+/**
+ * @brief Game time
+ *
+ * Reads the monotonic clock used by gameStep().
+ *
+ * @return Current time in milliseconds
+ */
+int64_t gameTime() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Game input
+ *
+ * Queues new action for the passed instance, made at the current time
+ * of the monotonic clock.
+ *
+ * @param game Game handle
+ * @param action User action enum
+ * @param hold Is button held or not
+ */
+void gameInput(Game_t *game, UserAction_t action, bool hold) {
+  gameInputAt(game, action, hold, gameTime());
+}
+
+/**
+ * @brief Game input at
+ *
+ * Queues new action for the passed instance, made at the passed time.
+ * Up means no input and isn't queued. If the queue is full, the action
+ * is dropped and counted.
+ *
+ * @param game Game handle
+ * @param action User action enum
+ * @param hold Is button held or not
+ * @param time Time of the action in milliseconds
+ */
+void gameInputAt(Game_t *game, UserAction_t action, bool hold, int64_t time) {
+  Input_t input = {action, hold, time};
+
+  if (action != Up) inputPush(&game->inputs, input);
+}
+
+/**
+ * @brief Game dropped inputs
+ *
+ * Tells how many actions of the passed instance didn't fit into its
+ * input queue and were dropped.
+ *
+ * @param game Game handle
+ *
+ * @return Number of dropped actions
+ */
+uint64_t gameDroppedInputs(Game_t *game) {
+  return __atomic_load_n(&game->inputs.dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Game set repeat
+ *
+ * Sets the delays of auto-repeat of held lateral moves of the passed
+ * instance. Must be called from the thread which steps the game.
+ *
+ * @param game Game handle
+ * @param delay Delay before the first repeat in milliseconds
+ * @param interval Delay between two repeats in milliseconds
+ */
+void gameSetRepeat(Game_t *game, int delay, int interval) {
+  repeatSet(&game->repeat, delay, interval);
+}
+
+/**
+ * @brief Game snapshot
+ *
+ * Returns Game info struct of the passed instance. The field is
+ * refreshed from the board here, if the board has changed.
+ *
+ * @param game Game handle
+ *
+ * @return Game info struct
+ */
+GameInfo_t gameSnapshot(Game_t *game) {
+  if (game->field_dirty && game->stats.field) fill_field(game);
+
+  return game->stats;
+}
 
-  return prms->stats;
+/**
+ * @brief Game frame
+ *
+ * Returns a read-only view of the game info struct of the passed
+ * instance with its version and the parts changed after the seen
+ * version. The field is refreshed from the board here, if the board
+ * has changed.
+ *
+ * @param game Game handle
+ * @param seen Version the caller has seen, 0 if it hasn't seen any
+ *
+ * @return Game frame struct
+ */
+GameFrame_t gameFrame(Game_t *game, uint64_t seen) {
+  GameFrame_t frame = {&game->stats, game->track.version,
+                       frameChanges(&game->track, seen)};
+
+  if (game->field_dirty && game->stats.field) fill_field(game);
+
+  return frame;
+}
+
+/**
+ * @brief Game hash
+ *
+ * Returns the Zobrist hash of the position of the passed instance:
+ * the board with the moving figure on it and the kinds of the figure
+ * and of the next one.
+ *
+ * @param game Game handle
+ *
+ * @return Hash
+ */
+uint64_t gameHash(Game_t *game) { return game->hash; }
+
+/**
+ * @brief Game lines
+ *
+ * Returns the number of lines removed in the game of the passed instance.
+ *
+ * @param game Game handle
+ *
+ * @return Number of lines
+ */
+int gameLines(Game_t *game) { return game->lines; }
+
+/**
+ * @brief Destroy game
+ *
+ * Frees the game instance and all of its memory.
+ *
+ * @param game Game handle
+ */
+void gameDestroy(Game_t *game) {
+  if (game) {
+    mem_free(&game->stats);
+    plan_destroy(game->planner);
+    free(game);
+  }
 }
 
 /**
@@ -78,6 +377,62 @@ void fsm(Params_t *prms) {
   }
 }
 
+/**
+ * @brief Transient state
+ *
+ * Tells if the current state passes on by itself, without input.
+ *
+ * @param prms Params structure
+ *
+ * @return 1 if the state is transient, 0 otherwise
+ */
+int transient_state(Params_t *prms) {
+  return prms->state == SPAWN || prms->state == SHIFTING ||
+         prms->state == ATTACHING || prms->state == GAMEOVER;
+}
+
+/**
+ * @brief Repeatable
+ *
+ * Tells if the action repeats while held: only lateral moves do.
+ *
+ * @param action User action enum
+ *
+ * @return 1 if the action is repeatable, 0 otherwise
+ */
+int repeatable(UserAction_t action) {
+  return action == Left || action == Right;
+}
+
+/**
+ * @brief Auto repeat
+ *
+ * Repeats the held action at each of its deadlines which has come.
+ * Repeats are only applied while the figure is moving, the ones which
+ * come in other states are skipped.
+ *
+ * @param prms Params structure
+ *
+ * @return Number of applied repeats
+ */
+int auto_repeat(Params_t *prms) {
+  Repeat_t *repeat = &prms->repeat;
+  int repeats = 0;
+
+  while (repeat->active && repeat->next_at <= prms->now) {
+    if (prms->state == MOVING) {
+      prms->signal = repeat->action;
+      fsm(prms);
+      prms->signal = Up;
+      repeat->next_at += repeat->interval;
+      repeats++;
+    } else {
+      repeat->next_at = prms->now + repeat->interval;
+    }
+  }
+  return repeats;
+}
+
 /**
  * @brief Start state
  *
@@ -102,6 +457,31 @@ void start(Params_t *prms) {
   }
 }
 
+/**
+ * @brief Matrix alloc
+ *
+ * Allocates a zeroed matrix in one contiguous block: the row pointers
+ * come first and point into the cells right after them, so the whole
+ * matrix is freed with a single free() and its cells can be walked
+ * as one flat array starting at the first row.
+ *
+ * @param rows Number of rows
+ * @param cols Number of columns
+ *
+ * @return Matrix or NULL if allocation failed
+ */
+int **matrix_alloc(int rows, int cols) {
+  int **matrix = calloc(1, rows * sizeof(int *) + rows * cols * sizeof(int));
+
+  if (matrix) {
+    int *cells = (int *)(matrix + rows);
+    for (int i = 0; i < rows; i++) {
+      matrix[i] = cells + i * cols;
+    }
+  }
+  return matrix;
+}
+
 /**
  * @brief Field alloc
  *
@@ -112,21 +492,9 @@ void start(Params_t *prms) {
  * @return Memory allocation status
  */
 int field_alloc(Params_t *prms) {
-  int error = 0;
-  prms->stats.field = calloc(FIELD_HEIGHT, sizeof(int *));
-  if (prms->stats.field == NULL) error = 1;
-
-  for (int i = 0; !error && i < FIELD_HEIGHT; i++) {
-    prms->stats.field[i] = calloc(FIELD_WIDTH, sizeof(int));
-    if (prms->stats.field[i] == NULL) {
-      error = 1;
-      for (int j = 0; j < i; j++) {
-        free(prms->stats.field[j]);
-      }
-      free(prms->stats.field);
-    }
-  }
-  return error;
+  prms->stats.field = matrix_alloc(FIELD_HEIGHT, FIELD_WIDTH);
+
+  return prms->stats.field == NULL;
 }
 
 /**
@@ -139,28 +507,22 @@ int field_alloc(Params_t *prms) {
  * @return Memory allocation status
  */
 int brick_alloc(Params_t *prms) {
-  int error = 0;
-  prms->stats.next = calloc(BRICK_SIDE, sizeof(int *));
-  if (prms->stats.next == NULL) error = 1;
-
-  for (int i = 0; !error && i < BRICK_SIDE; i++) {
-    prms->stats.next[i] = calloc(BRICK_SIDE, sizeof(int));
-    if (prms->stats.next[i] == NULL) {
-      error = 1;
-      for (int j = 0; j < i; j++) {
-        free(prms->stats.next[j]);
-      }
-      free(prms->stats.next);
-    }
-  }
-  return error;
+  prms->stats.next = matrix_alloc(BRICK_SIDE, BRICK_SIDE);
+
+  return prms->stats.next == NULL;
 }
 
 /**
  * @brief Stats init
  *
- * Initializes score, level, speed, ticks, clears the field on new game,
- * sets rand(), generates next brick, reads highscore from file.
+ * Initializes score, level, speed, schedules the first gravity step,
+ * clears the field on new game, seeds the game's random generator on the
+ * first game, remembers the generator state the game starts with,
+ * generates next brick, takes highscore from the high score store, which
+ * reads it from file only once.
+ *
+ * The seed is taken from params or from the current time if it's 0.
+ * Later games continue the same random sequence.
  *
  * @param prms Params structure
  */
@@ -168,38 +530,25 @@ void stats_init(Params_t *prms) {
   prms->stats.score = 0;
   prms->stats.level = 1;
   prms->stats.speed = 1;
-  prms->ticks = 0;
+  prms->step_at = prms->now + step_interval(prms);
+  prms->lines = 0;
+  prms->started_at = prms->now;
 
   if (prms->stats.pause == GAMELOST) {
     for (int i = 0; i < FIELD_HEIGHT; i++) {
-      for (int j = 0; j < FIELD_WIDTH; j++) {
-        prms->stats.field[i][j] = 0;
-      }
-    }
-
-    for (int i = 0; i < BRICK_SIDE; i++) {
-      for (int j = 0; j < BRICK_SIDE; j++) {
-        prms->stats.next[i][j] = 0;
-      }
+      prms->hash ^= zobristRow(i, prms->board[i]);
+      prms->board[i] = 0;
     }
+    prms->field_dirty = 1;
 
     prms->stats.pause = PLAYING;
   } else {
-    srand(time(NULL));
-  }
-  generate_brick(rand() % 7, prms);
-
-  FILE *fp = fopen("brick_game/tetris/high_score.txt", "r");
-  if (!fp) {
-    fp = fopen("../../../brick_game/tetris/high_score.txt", "r");
+    rngSeed(&prms->rng, prms->seed ? prms->seed : (uint64_t)time(NULL));
   }
+  prms->game_seed = prms->rng.state;
+  generate_brick(rngBounded(&prms->rng, BRICK_PIECES), prms);
 
-  if (fp) {
-    fscanf(fp, "%d", &prms->stats.high_score);
-    fclose(fp);
-  } else {
-    prms->stats.high_score = 0;
-  }
+  prms->stats.high_score = highScoreLoad(HIGH_SCORE_PATH);
 }
 
 /**
@@ -211,41 +560,12 @@ void stats_init(Params_t *prms) {
  * @param prms Params structure
  */
 void generate_brick(int id, Params_t *prms) {
+  prms->hash ^= piece_hash(prms->brick.next_brick, 1) ^ piece_hash(id, 1);
   prms->brick.next_brick = id;
-  switch (id) {
-    case I_PIECE:
-      prms->stats.next[1][0] = prms->stats.next[1][1] = prms->stats.next[1][2] =
-          prms->stats.next[1][3] = 1;
-      break;
-
-    case J_PIECE:
-      prms->stats.next[1][0] = prms->stats.next[1][1] = prms->stats.next[1][2] =
-          prms->stats.next[2][2] = 1;
-      break;
-
-    case L_PIECE:
-      prms->stats.next[1][0] = prms->stats.next[1][1] = prms->stats.next[1][2] =
-          prms->stats.next[2][0] = 1;
-      break;
-
-    case O_PIECE:
-      prms->stats.next[1][1] = prms->stats.next[1][2] = prms->stats.next[2][1] =
-          prms->stats.next[2][2] = 1;
-      break;
-
-    case S_PIECE:
-      prms->stats.next[2][0] = prms->stats.next[2][1] = prms->stats.next[1][1] =
-          prms->stats.next[1][2] = 1;
-      break;
-
-    case T_PIECE:
-      prms->stats.next[1][0] = prms->stats.next[1][1] = prms->stats.next[1][2] =
-          prms->stats.next[2][1] = 1;
-      break;
-
-    case Z_PIECE:
-      prms->stats.next[1][0] = prms->stats.next[1][1] = prms->stats.next[2][1] =
-          prms->stats.next[2][2] = 1;
+  for (int i = 0; i < BRICK_SIDE; i++) {
+    for (int j = 0; j < BRICK_SIDE; j++) {
+      prms->stats.next[i][j] = brick_shapes[id][0][i] >> j & 1;
+    }
   }
 }
 
@@ -259,7 +579,7 @@ void generate_brick(int id, Params_t *prms) {
 void spawn(Params_t *prms) {
   spawn_brick(prms);
 
-  generate_brick(rand() % 7, prms);
+  generate_brick(rngBounded(&prms->rng, BRICK_PIECES), prms);
   prms->state = MOVING;
 }
 
@@ -271,14 +591,11 @@ void spawn(Params_t *prms) {
  * @param prms Params structure
  */
 void spawn_brick(Params_t *prms) {
-  for (int i = 0; i < BRICK_SIDE; i++) {
-    for (int j = 0; j < BRICK_SIDE; j++) {
-      prms->brick.matrix[i][j] = prms->stats.next[i][j];
-      prms->stats.next[i][j] = 0;
-    }
-  }
+  prms->brick.rotation = 0;
   prms->brick.x = BRICKSTART_X;
   prms->brick.y = BRICKSTART_Y;
+  prms->hash ^= piece_hash(prms->brick.piece, 0) ^
+                piece_hash(prms->brick.next_brick, 0);
   prms->brick.piece = prms->brick.next_brick;
 }
 
@@ -288,8 +605,8 @@ void spawn_brick(Params_t *prms) {
  * In this state the figure can be moved and rotated. If action button is
  * pressed, rotates the figure. The figure can also be moved left and right, and
  * dropped down. A pause button can be pressed to pause the game. Or a terminate
- * button can be pressed to exit the game. By default increases game ticks
- * and switches the state to SHIFTING if enough ticks were passed.
+ * button can be pressed to exit the game. By default switches the state
+ * to SHIFTING when the deadline of the gravity step has come.
  *
  * @param prms Params structure
  */
@@ -325,10 +642,9 @@ void moving(Params_t *prms) {
       break;
 
     default:
-      prms->ticks++;
-      if (prms->ticks >= INITIAL_TIMEOUT / (prms->stats.speed * 0.1)) {
+      if (prms->now >= prms->step_at) {
         prms->state = SHIFTING;
-        prms->ticks = 0;
+        next_step(prms);
       }
   }
   place_brick(prms);
@@ -337,65 +653,91 @@ void moving(Params_t *prms) {
 /**
  * @brief Clear brick
  *
- * Clears the figure from the field before moving.
+ * Clears the figure from the field before moving. The keys of the cells
+ * it leaves are taken out of the hash.
  *
  * @param prms Params structure
  */
 void clear_brick(Params_t *prms) {
+  const uint8_t *rows = brick_rows(prms);
+
   for (int i = 0; i < BRICK_SIDE; i++) {
-    for (int j = 0; j < BRICK_SIDE; j++) {
-      if (prms->brick.matrix[i][j] == 1) {
-        prms->stats.field[i + prms->brick.y][j + prms->brick.x] = 0;
-      }
+    int y = i + prms->brick.y;
+    if (rows[i] && y >= 0 && y < FIELD_HEIGHT) {
+      uint16_t cells = prms->board[y] & brick_row(prms, i);
+      prms->board[y] &= ~cells;
+      prms->hash ^= zobristRow(y, cells);
     }
   }
+  prms->field_dirty = 1;
 }
 
 /**
  * @brief Place brick
  *
- * Places the figure to the field after moving.
+ * Places the figure to the field after moving. The keys of the cells
+ * it fills are added to the hash.
  *
  * @param prms Params structure
  */
 void place_brick(Params_t *prms) {
+  const uint8_t *rows = brick_rows(prms);
+
   for (int i = 0; i < BRICK_SIDE; i++) {
-    for (int j = 0; j < BRICK_SIDE; j++) {
-      if (prms->brick.matrix[i][j] == 1) {
-        prms->stats.field[i + prms->brick.y][j + prms->brick.x] = 1;
-      }
+    int y = i + prms->brick.y;
+    if (rows[i] && y >= 0 && y < FIELD_HEIGHT) {
+      uint16_t cells = brick_row(prms, i) & ~prms->board[y];
+      prms->board[y] |= cells;
+      prms->hash ^= zobristRow(y, cells);
     }
   }
+  prms->field_dirty = 1;
 }
 
 /**
- * @brief Rotate brick
+ * @brief Brick rows
  *
- * Rotates the figure clockwise.
+ * Looks up the figure's shape by its piece and rotation.
+ *
+ * @param prms Params structure
+ *
+ * @return Row bitmasks of the figure's 4x4 matrix
+ */
+const uint8_t *brick_rows(Params_t *prms) {
+  return brick_shapes[prms->brick.piece][prms->brick.rotation];
+}
+
+/**
+ * @brief Brick row
+ *
+ * Shifts a row of the figure to the figure's column on the board.
+ * Cells outside of the board are cut off.
  *
  * @param prms Params structure
+ * @param i Row of the figure
+ *
+ * @return Row bitmask in board coordinates
  */
-void rotate_brick(Params_t *prms) {
-  Brick_t temp = {};
-  int adjustment;
+uint16_t brick_row(Params_t *prms, int i) {
+  unsigned row = brick_rows(prms)[i];
 
-  if (prms->brick.piece == I_PIECE)
-    adjustment = 0;
+  if (prms->brick.x >= 0)
+    row <<= prms->brick.x;
   else
-    adjustment = 1;
+    row >>= -prms->brick.x;
 
-  for (int i = 0; i < BRICK_SIDE - adjustment; i++) {
-    for (int j = 0; j < BRICK_SIDE - adjustment; j++) {
-      temp.matrix[i][BRICK_SIDE - j - 1 - adjustment] =
-          prms->brick.matrix[j][i];
-    }
-  }
+  return row & FIELD_ROW_FULL;
+}
 
-  for (int i = 0; i < BRICK_SIDE - adjustment; i++) {
-    for (int j = 0; j < BRICK_SIDE - adjustment; j++) {
-      prms->brick.matrix[i][j] = temp.matrix[i][j];
-    }
-  }
+/**
+ * @brief Rotate brick
+ *
+ * Rotates the figure clockwise.
+ *
+ * @param prms Params structure
+ */
+void rotate_brick(Params_t *prms) {
+  prms->brick.rotation = (prms->brick.rotation + 1) % BRICK_ROTATIONS;
 }
 
 /**
@@ -406,26 +748,8 @@ void rotate_brick(Params_t *prms) {
  * @param prms Params structure
  */
 void rotate_backwards(Params_t *prms) {
-  Brick_t temp = {};
-  int adjustment;
-
-  if (prms->brick.piece == I_PIECE)
-    adjustment = 0;
-  else
-    adjustment = 1;
-
-  for (int i = 0; i < BRICK_SIDE - adjustment; i++) {
-    for (int j = 0; j < BRICK_SIDE - adjustment; j++) {
-      temp.matrix[j][i] =
-          prms->brick.matrix[i][BRICK_SIDE - j - 1 - adjustment];
-    }
-  }
-
-  for (int i = 0; i < BRICK_SIDE - adjustment; i++) {
-    for (int j = 0; j < BRICK_SIDE - adjustment; j++) {
-      prms->brick.matrix[i][j] = temp.matrix[i][j];
-    }
-  }
+  prms->brick.rotation =
+      (prms->brick.rotation + BRICK_ROTATIONS - 1) % BRICK_ROTATIONS;
 }
 
 /**
@@ -493,27 +817,59 @@ void shifting(Params_t *prms) {
   }
 }
 
+/**
+ * @brief Step interval
+ *
+ * Time between two gravity steps at the current speed.
+ *
+ * @param prms Params structure
+ *
+ * @return Interval in milliseconds
+ */
+int step_interval(Params_t *prms) {
+  return INITIAL_TIMEOUT / prms->stats.speed;
+}
+
+/**
+ * @brief Next step
+ *
+ * Moves the gravity deadline one interval forward, so steps keep a fixed
+ * rate however often the game is updated. If the game is late by more
+ * than an interval, the backlog is dropped instead of being caught up.
+ *
+ * @param prms Params structure
+ */
+void next_step(Params_t *prms) {
+  prms->step_at += step_interval(prms);
+  if (prms->step_at < prms->now) prms->step_at = prms->now;
+}
+
 /**
  * @brief Check collision
  *
  * Defines if a collision with a solid ground has occured.
  *
+ * Board rows are shifted by BRICK_SIDE bits and surrounded with wall bits,
+ * so a figure row is checked against walls and cells with a single AND.
+ *
  * @param prms Params structure
  *
  * @return Collision status
  */
 int check_collision(Params_t *prms) {
-  int collision = 0;
+  const uint8_t *rows = brick_rows(prms);
+  int collision =
+      prms->brick.x < -BRICK_SIDE || prms->brick.x > FIELD_WIDTH;
 
   for (int i = 0; !collision && i < BRICK_SIDE; i++) {
-    for (int j = 0; j < BRICK_SIDE; j++) {
-      if (prms->brick.matrix[i][j] == 1 &&
-          ((i + prms->brick.y >= FIELD_HEIGHT || i + prms->brick.y < 0 ||
-            j + prms->brick.x >= FIELD_WIDTH || j + prms->brick.x < 0) ||
-           (prms->stats.field[i + prms->brick.y][prms->brick.x + j] == 1)))
-
-        collision = 1;
-    }
+    int y = i + prms->brick.y;
+    uint32_t row = (uint32_t)rows[i] << (prms->brick.x + BRICK_SIDE);
+
+    if (row && (y >= FIELD_HEIGHT || y < 0))
+      collision = 1;
+    else if (row)
+      collision =
+          (row & (((uint32_t)prms->board[y] << BRICK_SIDE) | FIELD_WALLS)) != 0;
   }
   return collision;
 }
@@ -542,42 +898,46 @@ void attaching(Params_t *prms) {
 /**
  * @brief Remove line
  *
- * Removes a complete line, moves field down and increases the score.
+ * Removes complete lines and increases the score.
+ *
+ * The board is compacted in a single bottom-up pass: every remaining
+ * row is moved down at most once, right to its final place. Removed
+ * rows are reported as a bitmask, bit i is the board row i before
+ * the removal. The hash follows the rows which are removed or moved,
+ * the ones which stay in place aren't hashed again.
  *
  * @param prms Params structure
+ *
+ * @return Bitmask of the removed rows
  */
-void remove_line(Params_t *prms) {
-  int sum = 1;
-  for (int i = FIELD_HEIGHT - 1; sum > 0 && i > 0; i--) {
-    sum = prms->stats.field[i][0] + prms->stats.field[i][1] +
-          prms->stats.field[i][2] + prms->stats.field[i][3] +
-          prms->stats.field[i][4] + prms->stats.field[i][5] +
-          prms->stats.field[i][6] + prms->stats.field[i][7] +
-          prms->stats.field[i][8] + prms->stats.field[i][9];
+uint32_t remove_line(Params_t *prms) {
+  int bottom = FIELD_HEIGHT - 1;
 
-    if (sum == FIELD_WIDTH) {
+  prms->cleared_rows = 0;
+  for (int i = FIELD_HEIGHT - 1; i >= 0; i--) {
+    if (prms->board[i] == FIELD_ROW_FULL) {
+      prms->cleared_rows |= 1u << i;
       prms->lines_at_once += 1;
-      move_field_down(prms, i);
-      i++;
+      prms->hash ^= zobristRow(i, FIELD_ROW_FULL);
+    } else {
+      if (bottom != i) {
+        prms->hash ^= zobristRow(i, prms->board[i]) ^
+                      zobristRow(bottom, prms->board[i]);
+        prms->board[bottom] = prms->board[i];
+      }
+      bottom--;
     }
   }
-  if (prms->lines_at_once > 0) increase_score(prms);
-  prms->lines_at_once = 0;
-}
 
-/**
- * @brief Move field down
- *
- * Moves field down for every complete line.
- *
- * @param prms Params structure
- */
-void move_field_down(Params_t *prms, int line) {
-  for (int i = line; i > 0; i--) {
-    for (int j = 0; j < FIELD_WIDTH; j++) {
-      prms->stats.field[i][j] = prms->stats.field[i - 1][j];
-    }
+  if (prms->lines_at_once > 0) {
+    prms->lines += prms->lines_at_once;
+    memset(prms->board, 0, (bottom + 1) * sizeof(prms->board[0]));
+    prms->field_dirty = 1;
+    increase_score(prms);
   }
+  prms->lines_at_once = 0;
+
+  return prms->cleared_rows;
 }
 
 /**
@@ -637,13 +997,7 @@ void increase_level(Params_t *prms) {
  *
  * @param prms Params structure
  */
-int check_game_over(Params_t *prms) {
-  int game_over = 0;
-  for (int i = 0; i < FIELD_WIDTH; i++) {
-    game_over += prms->stats.field[0][i];
-  }
-  return game_over > 0;
-}
+int check_game_over(Params_t *prms) { return prms->board[0] != 0; }
 
 /**
  * @brief Pause state
@@ -651,6 +1005,7 @@ int check_game_over(Params_t *prms) {
  * Pauses and unpauses the game.
  *
  * The game starts with this state, the memory is also allocated here.
+ * On resume the gravity step is scheduled a full interval ahead.
  *
  * @param prms Params structure
  */
@@ -673,6 +1028,7 @@ void pause(Params_t *prms) {
     case Pause:
       prms->state = MOVING;
       prms->stats.pause = PLAYING;
+      prms->step_at = prms->now + step_interval(prms);
       break;
 
     case Terminate:
@@ -697,6 +1053,7 @@ int mem_alloc(Params_t *prms) {
   int error;
   error = field_alloc(prms);
   if (!error) error = brick_alloc(prms);
+  if (error) mem_free(&prms->stats);
   return error;
 }
 
@@ -716,21 +1073,23 @@ void gameover(Params_t *prms) {
 /**
  * @brief Save highscore
  *
- * Opens a file and saves current game's score if it's exceeded highscore.
+ * Hands current game's result to the high score store: its score
+ * becomes the highscore if it's exceeded it, and the result goes to
+ * the leaderboard. The store writes both to files on its own thread,
+ * so a game over never waits for the disk.
  *
  * @param prms Params structure
  */
 void saveHighScore(Params_t *prms) {
-  if (prms->stats.high_score == prms->stats.score && prms->stats.score > 0) {
-    FILE *fp = fopen("brick_game/tetris/high_score.txt", "w");
-    if (!fp) {
-      fp = fopen("../../../brick_game/tetris/high_score.txt", "w");
-    }
-
-    if (fp) {
-      fprintf(fp, "%d", prms->stats.high_score);
-      fclose(fp);
-    }
+  if (prms->stats.score > 0) {
+    LeaderEntry_t entry = {.score = prms->stats.score,
+                           .level = prms->stats.level,
+                           .count = prms->lines,
+                           .duration = prms->now - prms->started_at,
+                           .seed = prms->game_seed,
+                           .timestamp = (int64_t)time(NULL)};
+
+    highScoreRecord(&entry);
   }
 }
 
@@ -745,66 +1104,167 @@ void saveHighScore(Params_t *prms) {
  */
 void exit_state(Params_t *prms) {
   prms->stats.pause = GAMEEXIT;
-  memFree();
+  mem_free(&prms->stats);
+}
+
+/**
+ * @brief Get hash
+ *
+ * Returns the Zobrist hash of the position of the default game.
+ *
+ * @return Hash
+ */
+uint64_t getHash() { return gameHash(get_params()); }
+
+/**
+ * @brief Board hash
+ *
+ * Computes the hash of the position from scratch: the keys of all
+ * filled cells and of the kinds of the moving and the next figure.
+ * The incrementally kept hash always equals it.
+ *
+ * @param prms Params structure
+ *
+ * @return Hash
+ */
+uint64_t board_hash(Params_t *prms) {
+  uint64_t hash = piece_hash(prms->brick.piece, 0) ^
+                  piece_hash(prms->brick.next_brick, 1);
+
+  for (int i = 0; i < FIELD_HEIGHT; i++) {
+    hash ^= zobristRow(i, prms->board[i]);
+  }
+  return hash;
+}
+
+/**
+ * @brief Piece hash
+ *
+ * Returns the key of a figure kind in one of the slots: 0 for the moving
+ * figure, 1 for the next one. The I piece has the key 0, so that zeroed
+ * params, as the default game starts with, hash to 0.
+ *
+ * @param piece Brick piece
+ * @param slot Slot of the figure
+ *
+ * @return Key
+ */
+uint64_t piece_hash(int piece, int slot) {
+  return piece == I_PIECE
+             ? 0
+             : zobristKey(ZOBRIST_CELLS + slot * BRICK_PIECES + piece);
 }
 
 /**
  * @brief Memory free
  *
- * Frees allocated memory. No argument needed.
+ * Frees allocated memory of the default game, its planner included.
+ * No argument needed.
  */
 void memFree() {
-  GameInfo_t stats = getStats();
+  Params_t *prms = get_params();
 
-  mem_free(&stats);
+  mem_free(&prms->stats);
+  plan_destroy(prms->planner);
+  prms->planner = NULL;
 }
 
 /**
  * @brief Free memory
  *
- * Frees allocated memory from an argument.
+ * Frees allocated memory from an argument. Already freed memory
+ * is skipped.
  *
  * @param stats Game info structure
  */
 void mem_free(GameInfo_t *stats) {
-  for (int i = 0; i < FIELD_HEIGHT; i++) {
-    free(stats->field[i]);
-  }
   free(stats->field);
   stats->field = NULL;
 
-  for (int i = 0; i < BRICK_SIDE; i++) {
-    free(stats->next[i]);
-  }
   free(stats->next);
   stats->next = NULL;
 }
 
+/**
+ * @brief Fill field
+ *
+ * Fills the field of the game info struct from the board, so views
+ * can draw it cell by cell.
+ *
+ * @param prms Params structure
+ */
+void fill_field(Params_t *prms) {
+  int *cells = prms->stats.field[0];
+
+  for (int i = 0; i < FIELD_HEIGHT; i++) {
+    for (int j = 0; j < FIELD_WIDTH; j++) {
+      *cells++ = prms->board[i] >> j & 1;
+    }
+  }
+  prms->field_dirty = 0;
+}
+
 /**
  * @brief User input
  *
  * Accepts user's proccessed input into action.
  *
- * Updates current signal with new action.
+ * Updates current signal of the default game with new action.
  *
  * @param action User action enum
  * @param hold Is button held or not
  */
 void userInput(UserAction_t action, bool hold) {
-  (void)hold;
-  Params_t *prms = get_params();
-  prms->signal = action;
+  gameInput(get_params(), action, hold);
 }
 
 /**
  * @brief Get stats
  *
- * Returns updated Game info struct.
+ * Returns updated Game info struct of the default game.
  *
  * @return Game info struct
  */
-GameInfo_t getStats() {
-  Params_t *prms = get_params();
+GameInfo_t getStats() { return gameSnapshot(get_params()); }
 
-  return prms->stats;
+/**
+ * @brief Get frame
+ *
+ * Returns a read-only view of the game info struct of the default game
+ * with its version and the parts changed after the seen version.
+ *
+ * @param seen Version the caller has seen, 0 if it hasn't seen any
+ *
+ * @return Game frame struct
+ */
+GameFrame_t getFrame(uint64_t seen) { return gameFrame(get_params(), seen); }
+
+/**
+ * @brief Get deadline
+ *
+ * Returns the time the default game has to be updated next.
+ *
+ * @return Time in milliseconds or NO_DEADLINE if the game waits for input
+ */
+int64_t getDeadline() { return gameDeadline(get_params()); }
+
+/**
+ * @brief Get dropped inputs
+ *
+ * Returns the number of actions the default game has dropped.
+ *
+ * @return Number of dropped actions
+ */
+uint64_t getDroppedInputs() { return gameDroppedInputs(get_params()); }
+
+/**
+ * @brief Set repeat
+ *
+ * Sets the delays of auto-repeat of the default game.
+ *
+ * @param delay Delay before the first repeat in milliseconds
+ * @param interval Delay between two repeats in milliseconds
+ */
+void setRepeat(int delay, int interval) {
+  gameSetRepeat(get_params(), delay, interval);
 }
@@ -1,17 +1,34 @@
 #ifndef TETRIS_MODEL_H
 #define TETRIS_MODEL_H
 
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
 /// @file
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "../../common.h"
+#include "../common/high_score.h"
+
+#ifndef HIGH_SCORE_PATH
+#define HIGH_SCORE_PATH "brick_game/tetris/high_score.txt"
+#endif
 
 #define BRICKSTART_X 3
 #define BRICKSTART_Y -1
 
+#define BRICK_PIECES 7
+#define BRICK_ROTATIONS 4
+
+#define FIELD_ROW_FULL ((uint16_t)((1u << FIELD_WIDTH) - 1))
+#define FIELD_WALLS (~((uint32_t)FIELD_ROW_FULL << BRICK_SIDE))
+
 /**
  * @brief Brick piece enum
  *
@@ -30,38 +47,72 @@ typedef enum {
 /**
  * @brief Brick struct
  *
- * A structure which holds brick coordinates (x,y), matrix of the brick,
+ * A structure which holds brick coordinates (x,y), rotation state,
  * enumerated type of the current and next bricks.
+ *
+ * The brick's shape is looked up in brick_shapes by its piece and rotation.
  */
 typedef struct {
   BrickPiece_t piece;
   BrickPiece_t next_brick;
+  int rotation;
   int x;
   int y;
-  int matrix[4][4];
 } Brick_t;
 
+extern const uint8_t brick_shapes[BRICK_PIECES][BRICK_ROTATIONS][BRICK_SIDE];
+
 /**
  * @brief Params struct
  *
  * The main structure which holds everything needed in the game.
+ * It is also the game handle (Game_t) of the public API.
+ *
+ * Contains current game time, the deadline of the next gravity step and
+ * the start of the game in milliseconds, complete lines at once and
+ * in the game, rows removed by the last attached figure, random seed,
+ * generator and its state at the start of the game, brick struct, board,
+ * game info struct, game state enum, user action enum, the queue
+ * of inputs not applied yet, auto-repeat of held actions, versions
+ * of the frames, the planner of the bot, NULL unless planning is on,
+ * and the Zobrist hash of the position, updated with every change of
+ * the board and of the figures.
  *
- * Contains game ticks, complete lines at once, brick struct,
- * game info struct, game state enum and user action enum.
+ * The board is the only game field the model works with: one bitmask
+ * per row, bit j is column j. The field of the game info struct is only
+ * filled from it when a snapshot is taken.
  */
-typedef struct {
-  int ticks;
+typedef struct Game {
+  int64_t now;
+  int64_t step_at;
+  int64_t started_at;
   int lines_at_once;
+  int lines;
+  uint32_t cleared_rows;
+  int field_dirty;
+  uint64_t seed;
+  uint64_t game_seed;
+  Rng_t rng;
   Brick_t brick;
+  uint16_t board[FIELD_HEIGHT];
   GameInfo_t stats;
   GameState_t state;
   UserAction_t signal;
+  InputQueue_t inputs;
+  Repeat_t repeat;
+  FrameTrack_t track;
+  struct Planner *planner;
+  uint64_t hash;
 } Params_t;
 
 Params_t *get_params();
 void fsm(Params_t *prms);
+int transient_state(Params_t *prms);
+int repeatable(UserAction_t action);
+int auto_repeat(Params_t *prms);
 
 void start(Params_t *prms);
+int **matrix_alloc(int rows, int cols);
 int field_alloc(Params_t *prms);
 int brick_alloc(Params_t *prms);
 void stats_init(Params_t *prms);
@@ -71,8 +122,10 @@ void spawn(Params_t *prms);
 void spawn_brick(Params_t *prms);
 
 void moving(Params_t *prms);
+const uint8_t *brick_rows(Params_t *prms);
 void clear_brick(Params_t *prms);
 void place_brick(Params_t *prms);
+uint16_t brick_row(Params_t *prms, int i);
 void rotate_brick(Params_t *prms);
 void rotate_backwards(Params_t *prms);
 void moveright(Params_t *prms);
@@ -80,14 +133,15 @@ void moveleft(Params_t *prms);
 void movedown(Params_t *prms);
 
 void shifting(Params_t *prms);
+int step_interval(Params_t *prms);
+void next_step(Params_t *prms);
 int check_collision(Params_t *prms);
 
 void attaching(Params_t *prms);
-void remove_line(Params_t *prms);
+uint32_t remove_line(Params_t *prms);
 void increase_score(Params_t *prms);
 void increase_level(Params_t *prms);
 int check_game_over(Params_t *prms);
-void move_field_down(Params_t *prms, int line);
 
 void pause(Params_t *prms);
 int mem_alloc(Params_t *prms);
@@ -96,6 +150,10 @@ void gameover(Params_t *prms);
 void saveHighScore(Params_t *prms);
 
 void exit_state(Params_t *prms);
+uint64_t board_hash(Params_t *prms);
+uint64_t piece_hash(int piece, int slot);
 void mem_free(GameInfo_t *stats);
 
+void fill_field(Params_t *prms);
+
 #endif
@@ -0,0 +1,564 @@
+#include "tetris_planner.h"
+
+/// @file
+/**
+ * @brief Game set planning
+ *
+ * Switches the bot of the passed instance to the planning mode with
+ * the given config, or back to the single piece bot without one.
+ * The planner keeps its transposition cache for the whole life of
+ * the instance, over all of its games.
+ *
+ * @param game Game handle
+ * @param config Plan config struct or NULL
+ *
+ * @return 0 on success, -1 if the planner can't be allocated
+ */
+int gameSetPlanning(Game_t *game, const PlanConfig_t *config) {
+  plan_destroy(game->planner);
+  game->planner = config ? plan_create(config, &bot_default_weights) : NULL;
+
+  return config && !game->planner ? -1 : 0;
+}
+
+/**
+ * @brief Set planning
+ *
+ * Switches the bot of the default game to the planning mode.
+ *
+ * @param config Plan config struct or NULL
+ *
+ * @return 0 on success, -1 if the planner can't be allocated
+ */
+int setPlanning(const PlanConfig_t *config) {
+  return gameSetPlanning(get_params(), config);
+}
+
+/**
+ * @brief Plan create
+ *
+ * Allocates a planner and its transposition cache and starts its worker
+ * threads, all but the one calling the planner. The config is clamped
+ * to the supported beam width and number of threads. A worker which
+ * can't be started just leaves the planner with fewer threads.
+ *
+ * @param config Plan config struct
+ * @param weights Bot weights struct, must outlive the planner
+ *
+ * @return Planner or NULL if it can't be allocated
+ */
+Planner_t *plan_create(const PlanConfig_t *config,
+                       const BotWeights_t *weights) {
+  Planner_t *planner = calloc(1, sizeof(Planner_t));
+
+  if (planner) {
+    planner->config = *config;
+    if (planner->config.beam < 1) planner->config.beam = 1;
+    if (planner->config.beam > PLAN_MAX_BEAM)
+      planner->config.beam = PLAN_MAX_BEAM;
+    if (planner->config.threads < 1) planner->config.threads = 1;
+    if (planner->config.threads > PLAN_MAX_THREADS)
+      planner->config.threads = PLAN_MAX_THREADS;
+    planner->weights = weights;
+    planner->cache = calloc(PLAN_CACHE_SIZE, sizeof(PlanEntry_t));
+    if (!planner->cache) {
+      free(planner);
+      planner = NULL;
+    }
+  }
+  if (planner) {
+    pthread_mutex_init(&planner->lock, NULL);
+    pthread_cond_init(&planner->wake, NULL);
+    pthread_cond_init(&planner->done, NULL);
+    for (int i = 1; i < planner->config.threads; i++) {
+      if (pthread_create(&planner->workers[planner->started], NULL,
+                         plan_thread, planner) == 0)
+        planner->started++;
+    }
+  }
+
+  return planner;
+}
+
+/**
+ * @brief Plan destroy
+ *
+ * Stops the worker threads of a planner and frees it. NULL is skipped.
+ *
+ * @param planner Planner struct
+ */
+void plan_destroy(Planner_t *planner) {
+  if (planner) {
+    pthread_mutex_lock(&planner->lock);
+    planner->stopping = 1;
+    pthread_cond_broadcast(&planner->wake);
+    pthread_mutex_unlock(&planner->lock);
+    for (int i = 0; i < planner->started; i++) {
+      pthread_join(planner->workers[i], NULL);
+    }
+    pthread_cond_destroy(&planner->done);
+    pthread_cond_destroy(&planner->wake);
+    pthread_mutex_destroy(&planner->lock);
+    free(planner->cache);
+    free(planner);
+  }
+}
+
+/**
+ * @brief Plan action
+ *
+ * Chooses the next action of the bot like bot_action() does, towards
+ * the placement found by the lookahead search.
+ *
+ * @param planner Planner struct
+ * @param prms Params structure
+ *
+ * @return User action enum
+ */
+UserAction_t plan_action(Planner_t *planner, Params_t *prms) {
+  UserAction_t action = Up;
+  BotMove_t best;
+
+  if (prms->stats.pause == STARTING || prms->stats.pause == GAMELOST) {
+    action = Start;
+  } else if (prms->state == MOVING && prms->stats.pause == PLAYING &&
+             plan_best_move(planner, prms, &best)) {
+    action = bot_steer(prms, &best);
+  }
+
+  return action;
+}
+
+/**
+ * @brief Plan best move
+ *
+ * Finds the placement of the moving figure with the best outcome over
+ * the pieces of the preview. A figure is planned once, when the first
+ * action is asked for it, then steered to the planned placement as long
+ * as it stays reachable. Planning again after every action would let
+ * the beam, which depends on where the figure is, change the plan back
+ * and forth.
+ *
+ * @param planner Planner struct
+ * @param prms Params structure
+ * @param best Best placement, its score is the value of the search
+ *
+ * @return 1 if there is a placement, 0 otherwise
+ */
+int plan_best_move(Planner_t *planner, Params_t *prms, BotMove_t *best) {
+  Params_t scratch;
+  int pieces[PLAN_MAX_PREVIEW + 1];
+  int preview = plan_preview(prms, pieces + 1);
+  int found = 1;
+
+  bot_scratch(&scratch, &prms->brick, prms->board);
+  bot_lift(&scratch);
+  pieces[0] = scratch.brick.piece;
+  uint64_t figure = plan_key(scratch.board, pieces, preview + 1);
+
+  if (planner->figure == figure && plan_reachable(planner, prms)) {
+    *best = planner->target;
+  } else {
+    found = plan_root(planner, &scratch, pieces + 1, preview, best);
+    planner->figure = found ? figure : 0;
+    planner->target = *best;
+  }
+
+  return found;
+}
+
+/**
+ * @brief Plan reachable
+ *
+ * Tells if the planned placement can still be reached by the moving
+ * figure.
+ *
+ * @param planner Planner struct
+ * @param prms Params structure
+ *
+ * @return 1 if it can, 0 otherwise
+ */
+int plan_reachable(Planner_t *planner, Params_t *prms) {
+  BotMove_t moves[BOT_MAX_MOVES];
+  int count = bot_moves(prms, planner->weights, moves);
+  int reachable = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (moves[i].rotation == planner->target.rotation &&
+        moves[i].x == planner->target.x && moves[i].y == planner->target.y)
+      reachable = 1;
+  }
+  return reachable;
+}
+
+/**
+ * @brief Plan root
+ *
+ * Searches the placements of the figure. They are evaluated as by
+ * the bot and the best ones kept in a beam. Every node of the beam
+ * is searched on the threads of the planner, unless its value is cached
+ * already. Once the budget is spent, nodes not searched yet are dropped,
+ * the best one is always searched.
+ *
+ * @param planner Planner struct
+ * @param scratch Scratch params structure, the figure not on the board
+ * @param pieces Pieces of the preview
+ * @param preview Number of pieces of the preview
+ * @param best Best placement, its score is the value of the search
+ *
+ * @return 1 if there is a placement, 0 otherwise
+ */
+int plan_root(Planner_t *planner, Params_t *scratch, const int *pieces,
+              int preview, BotMove_t *best) {
+  const BotWeights_t *weights = planner->weights;
+  PlanNode_t beam[PLAN_MAX_BEAM];
+  double values[PLAN_MAX_BEAM];
+  int searched[PLAN_MAX_BEAM];
+  int count = plan_beam(scratch, weights, planner->config.beam, beam);
+  int found = 0;
+
+  planner->nodes = 0;
+  planner->deadline =
+      planner->config.time_ms ? gameTime() + planner->config.time_ms : 0;
+  for (int i = 0; i < count; i++) {
+    searched[i] = beam[i].board[0] == 0 &&
+                  plan_lookup(planner, plan_key(beam[i].board, pieces, preview),
+                              &values[i]);
+  }
+  PlanJob_t job = {planner, pieces, preview, beam, values, searched, count, 0};
+  plan_run(&job);
+
+  for (int i = 0; i < count; i++) {
+    double total = weights->lines * beam[i].lines + values[i];
+
+    if (searched[i] && (!found || total > best->score)) {
+      *best = beam[i].move;
+      best->score = total;
+      found = 1;
+    }
+  }
+
+  return found;
+}
+
+/**
+ * @brief Plan preview
+ *
+ * Fills the pieces known to come after the moving figure. The game only
+ * shows the next one, a longer preview would be searched just as deep.
+ *
+ * @param prms Params structure
+ * @param pieces Array of PLAN_MAX_PREVIEW pieces to fill
+ *
+ * @return Number of pieces
+ */
+int plan_preview(const Params_t *prms, int *pieces) {
+  pieces[0] = prms->brick.next_brick;
+
+  return 1;
+}
+
+/**
+ * @brief Plan run
+ *
+ * Searches the nodes of the root beam which aren't cached on the worker
+ * threads of the planner and the calling one, and waits until all of
+ * them are done. The workers are only woken if more than one node is
+ * left to search.
+ *
+ * @param job Plan job struct
+ */
+void plan_run(PlanJob_t *job) {
+  Planner_t *planner = job->planner;
+  int misses = 0;
+
+  for (int i = 0; i < job->count; i++) misses += !job->searched[i];
+  if (planner->started && misses > 1) {
+    pthread_mutex_lock(&planner->lock);
+    planner->job = job;
+    planner->round++;
+    planner->busy = planner->started;
+    pthread_cond_broadcast(&planner->wake);
+    pthread_mutex_unlock(&planner->lock);
+    plan_worker(job);
+
+    pthread_mutex_lock(&planner->lock);
+    while (planner->busy) pthread_cond_wait(&planner->done, &planner->lock);
+    planner->job = NULL;
+    pthread_mutex_unlock(&planner->lock);
+  } else {
+    plan_worker(job);
+  }
+}
+
+/**
+ * @brief Plan thread
+ *
+ * Worker thread body: waits for the next job of the planner, works on
+ * it with plan_worker() and reports back, until the planner is destroyed.
+ *
+ * @param arg Planner struct
+ *
+ * @return Nothing
+ */
+void *plan_thread(void *arg) {
+  Planner_t *planner = (Planner_t *)arg;
+  unsigned long round = 0;
+
+  pthread_mutex_lock(&planner->lock);
+  while (!planner->stopping) {
+    if (planner->round == round) {
+      pthread_cond_wait(&planner->wake, &planner->lock);
+    } else {
+      PlanJob_t *job = planner->job;
+
+      round = planner->round;
+      pthread_mutex_unlock(&planner->lock);
+      plan_worker(job);
+      pthread_mutex_lock(&planner->lock);
+      if (--planner->busy == 0) pthread_cond_signal(&planner->done);
+    }
+  }
+  pthread_mutex_unlock(&planner->lock);
+
+  return NULL;
+}
+
+/**
+ * @brief Plan worker
+ *
+ * Thread body: takes the nodes of the root beam one by one, best first,
+ * and searches them while there is budget left.
+ *
+ * @param arg Plan job struct
+ *
+ * @return Nothing
+ */
+void *plan_worker(void *arg) {
+  PlanJob_t *job = (PlanJob_t *)arg;
+  int index;
+
+  while ((index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+         job->count) {
+    if (!job->searched[index] &&
+        (index == 0 || plan_budget_left(job->planner))) {
+      job->values[index] = plan_search(job->planner, job->beam[index].board,
+                                       job->pieces, job->preview);
+      job->searched[index] = 1;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Plan search
+ *
+ * Returns the value of a board for the given pieces still to come:
+ * the best evaluation reachable by placing them one after another, with
+ * the lines they remove, and only the placements in the beam of every
+ * piece tried. A board with a filled top row or on which the next piece
+ * can't spawn has lost. Values are cached by the board and the pieces,
+ * so a board reached by different placements is searched once.
+ *
+ * @param planner Planner struct
+ * @param board Board rows, without complete ones
+ * @param pieces Pieces to come
+ * @param preview Number of pieces to come
+ *
+ * @return Value, the higher the better
+ */
+double plan_search(Planner_t *planner, const uint16_t *board,
+                   const int *pieces, int preview) {
+  const BotWeights_t *weights = planner->weights;
+  uint64_t key = plan_key(board, pieces, preview);
+  double value = PLAN_TOPPED_OUT;
+
+  if (!board[0] && preview == 0) {
+    value = plan_value(board, weights);
+  } else if (!board[0] && !plan_lookup(planner, key, &value)) {
+    Params_t scratch;
+    PlanNode_t beam[PLAN_MAX_BEAM];
+    Brick_t spawned = {(BrickPiece_t)pieces[0], (BrickPiece_t)pieces[0], 0,
+                       BRICKSTART_X, BRICKSTART_Y};
+
+    bot_scratch(&scratch, &spawned, board);
+    if (!check_collision(&scratch)) {
+      int count = plan_beam(&scratch, weights, planner->config.beam, beam);
+
+      __atomic_add_fetch(&planner->nodes, count, __ATOMIC_RELAXED);
+      for (int i = 0; i < count; i++) {
+        double child = weights->lines * beam[i].lines +
+                       plan_search(planner, beam[i].board, pieces + 1,
+                                   preview - 1);
+        if (child > value) value = child;
+      }
+    }
+    plan_store(planner, key, value);
+  }
+
+  return value;
+}
+
+/**
+ * @brief Plan beam
+ *
+ * Enumerates the placements of the figure as the bot does and keeps
+ * the best ones, best first, with the boards they leave. The beam
+ * doesn't depend on the order of enumeration, which changes with
+ * the column of the figure, so the plan doesn't flip between moves.
+ *
+ * @param scratch Scratch params structure, the figure not on the board
+ * @param weights Bot weights struct
+ * @param width Maximum number of placements kept
+ * @param beam Array of width nodes to fill
+ *
+ * @return Number of placements kept
+ */
+int plan_beam(Params_t *scratch, const BotWeights_t *weights, int width,
+              PlanNode_t *beam) {
+  BotMove_t moves[BOT_MAX_MOVES];
+  int total = bot_moves(scratch, weights, moves);
+  int count = 0;
+
+  for (int i = 0; i < total; i++) {
+    if (count < width || plan_before(&moves[i], &beam[count - 1].move)) {
+      int j = count < width ? count++ : count - 1;
+
+      for (; j > 0 && plan_before(&moves[i], &beam[j - 1].move); j--)
+        beam[j].move = beam[j - 1].move;
+      beam[j].move = moves[i];
+    }
+  }
+  for (int i = 0; i < count; i++) {
+    Params_t placed;
+    Brick_t brick = scratch->brick;
+
+    brick.rotation = beam[i].move.rotation;
+    brick.x = beam[i].move.x;
+    brick.y = beam[i].move.y;
+    bot_scratch(&placed, &brick, scratch->board);
+    beam[i].lines = bot_land(&placed, beam[i].board);
+  }
+
+  return count;
+}
+
+/**
+ * @brief Plan before
+ *
+ * Orders placements by evaluation, ties by rotation and column.
+ *
+ * @param a Placement
+ * @param b Placement
+ *
+ * @return 1 if a comes before b in the beam, 0 otherwise
+ */
+int plan_before(const BotMove_t *a, const BotMove_t *b) {
+  return a->score > b->score ||
+         (a->score == b->score &&
+          (a->rotation < b->rotation ||
+           (a->rotation == b->rotation && a->x < b->x)));
+}
+
+/**
+ * @brief Plan value
+ *
+ * Evaluates a board at the end of the preview. The lines removed on
+ * the way are added by the caller.
+ *
+ * @param board Board rows, without complete ones
+ * @param weights Bot weights struct
+ *
+ * @return Evaluation, the higher the better
+ */
+double plan_value(const uint16_t *board, const BotWeights_t *weights) {
+  BotFeatures_t features;
+
+  bot_features(board, 0, &features);
+  return bot_score(&features, weights);
+}
+
+/**
+ * @brief Plan budget left
+ *
+ * Tells if the current search may go on: neither the placements nor
+ * the time of the budget are spent.
+ *
+ * @param planner Planner struct
+ *
+ * @return 1 if there is budget left, 0 otherwise
+ */
+int plan_budget_left(Planner_t *planner) {
+  long nodes = __atomic_load_n(&planner->nodes, __ATOMIC_RELAXED);
+
+  return (!planner->config.nodes || nodes < planner->config.nodes) &&
+         (!planner->deadline || gameTime() < planner->deadline);
+}
+
+/**
+ * @brief Plan key
+ *
+ * Hashes a board together with the pieces to come into the key of
+ * the transposition cache: the board is hashed with the keys of the game's
+ * Zobrist hash, every piece to come has keys of its own. The key is never
+ * 0, which empty entries hold.
+ *
+ * @param board Board rows
+ * @param pieces Pieces to come
+ * @param preview Number of pieces to come
+ *
+ * @return Key
+ */
+uint64_t plan_key(const uint16_t *board, const int *pieces, int preview) {
+  uint64_t key = 0;
+
+  for (int i = 0; i < FIELD_HEIGHT; i++) {
+    key ^= zobristRow(i, board[i]);
+  }
+  for (int i = 0; i < preview; i++) {
+    key ^= zobristKey(ZOBRIST_CELLS + (2 + i) * BRICK_PIECES + pieces[i]);
+  }
+
+  return key ? key : 1;
+}
+
+/**
+ * @brief Plan lookup
+ *
+ * Looks a value up in the transposition cache.
+ *
+ * @param planner Planner struct
+ * @param key Key of the position
+ * @param value Cached value
+ *
+ * @return 1 on a hit, 0 on a miss
+ */
+int plan_lookup(Planner_t *planner, uint64_t key, double *value) {
+  PlanEntry_t *entry = &planner->cache[key & (PLAN_CACHE_SIZE - 1)];
+  uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+  uint64_t bits = __atomic_load_n(&entry->value, __ATOMIC_RELAXED);
+  int hit = (check ^ bits) == key;
+
+  if (hit) memcpy(value, &bits, sizeof(bits));
+  return hit;
+}
+
+/**
+ * @brief Plan store
+ *
+ * Stores a value in the transposition cache over whatever its entry
+ * held.
+ *
+ * @param planner Planner struct
+ * @param key Key of the position
+ * @param value Value to store
+ */
+void plan_store(Planner_t *planner, uint64_t key, double value) {
+  PlanEntry_t *entry = &planner->cache[key & (PLAN_CACHE_SIZE - 1)];
+  uint64_t bits;
+
+  memcpy(&bits, &value, sizeof(bits));
+  __atomic_store_n(&entry->value, bits, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->check, key ^ bits, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,112 @@
+#ifndef TETRIS_PLANNER_H
+#define TETRIS_PLANNER_H
+
+/// @file
+#include <pthread.h>
+
+#include "tetris_bot.h"
+
+#define PLAN_MAX_PREVIEW 1
+#define PLAN_MAX_BEAM 32
+#define PLAN_MAX_THREADS 64
+#define PLAN_CACHE_BITS 16
+#define PLAN_CACHE_SIZE (1u << PLAN_CACHE_BITS)
+#define PLAN_TOPPED_OUT -1e9
+
+/**
+ * @brief Plan entry struct
+ *
+ * An entry of the transposition cache: the value of a position and its
+ * key xor the value's bits. Threads read and write entries without
+ * a lock, an entry torn by a concurrent write fails the key check and
+ * is a miss.
+ */
+typedef struct {
+  uint64_t check;
+  uint64_t value;
+} PlanEntry_t;
+
+/**
+ * @brief Plan node struct
+ *
+ * A placement in the beam: the move, its evaluation, the board it leaves
+ * and the lines it removes.
+ */
+typedef struct {
+  BotMove_t move;
+  uint16_t board[FIELD_HEIGHT];
+  int lines;
+} PlanNode_t;
+
+/**
+ * @brief Planner struct
+ *
+ * The planning mode of the bot: the plan config, the bot weights,
+ * the transposition cache shared by all searches of the planner,
+ * the budget of the current search: placements searched so far and
+ * the deadline in milliseconds of gameTime(), 0 for none, the last
+ * plan: the key of the figure, its board and preview, 0 for none, and
+ * the placement chosen for it, and the worker threads started with
+ * the planner: the job they are woken for, its round, the number of them
+ * still busy with it and whether they should stop.
+ */
+typedef struct Planner {
+  PlanConfig_t config;
+  const BotWeights_t *weights;
+  PlanEntry_t *cache;
+  long nodes;
+  int64_t deadline;
+  uint64_t figure;
+  BotMove_t target;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  pthread_t workers[PLAN_MAX_THREADS];
+  int started;
+  struct PlanJob *job;
+  unsigned long round;
+  int busy;
+  int stopping;
+} Planner_t;
+
+/**
+ * @brief Plan job struct
+ *
+ * The root beam of a search shared by the threads: the planner, the
+ * pieces of the preview, the beam, the deep value of every node, whether
+ * it has been searched and the shared counter of the next node.
+ */
+typedef struct PlanJob {
+  Planner_t *planner;
+  const int *pieces;
+  int preview;
+  const PlanNode_t *beam;
+  double *values;
+  int *searched;
+  int count;
+  int next;
+} PlanJob_t;
+
+Planner_t *plan_create(const PlanConfig_t *config, const BotWeights_t *weights);
+void plan_destroy(Planner_t *planner);
+UserAction_t plan_action(Planner_t *planner, Params_t *prms);
+int plan_best_move(Planner_t *planner, Params_t *prms, BotMove_t *best);
+int plan_reachable(Planner_t *planner, Params_t *prms);
+int plan_root(Planner_t *planner, Params_t *scratch, const int *pieces,
+              int preview, BotMove_t *best);
+int plan_preview(const Params_t *prms, int *pieces);
+void plan_run(PlanJob_t *job);
+void *plan_thread(void *arg);
+void *plan_worker(void *arg);
+double plan_search(Planner_t *planner, const uint16_t *board,
+                   const int *pieces, int preview);
+int plan_beam(Params_t *scratch, const BotWeights_t *weights, int width,
+              PlanNode_t *beam);
+int plan_before(const BotMove_t *a, const BotMove_t *b);
+double plan_value(const uint16_t *board, const BotWeights_t *weights);
+int plan_budget_left(Planner_t *planner);
+uint64_t plan_key(const uint16_t *board, const int *pieces, int preview);
+int plan_lookup(Planner_t *planner, uint64_t key, double *value);
+void plan_store(Planner_t *planner, uint64_t key, double value);
+
+#endif
@@ -6,6 +6,11 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#ifdef HASH_DEBUG
+#include <assert.h>
+#endif
 
 #define KEY_DOWN 0402
 #define KEY_UP 0403
@@ -18,10 +23,18 @@ extern "C" {
 #define FIELD_WIDTH 10
 #define BRICK_SIDE 4
 
-#ifdef __APPLE__
-#define INITIAL_TIMEOUT 50
+#define INITIAL_TIMEOUT 1000
+#define NO_DEADLINE -1
+#define INPUT_QUEUE_SIZE 64
+#define REPEAT_DELAY 170
+#define REPEAT_INTERVAL 50
+#define FRAME_PARTS 4
+#define ZOBRIST_CELLS (FIELD_WIDTH * FIELD_HEIGHT)
+
+#ifdef HASH_DEBUG
+#define HASH_CHECK(hash, fresh) assert((hash) == (fresh))
 #else
-#define INITIAL_TIMEOUT 350
+#define HASH_CHECK(hash, fresh) ((void)0)
 #endif
 
 /**
@@ -90,10 +103,449 @@ typedef struct {
   int pause;
 } GameInfo_t;
 
+/**
+ * @brief Frame change enum
+ *
+ * Parts of a game frame which change independently: game field, numbers
+ * of the HUD (score, highscore, level and speed), next figure and pause
+ * type. Used as bit flags.
+ */
+typedef enum {
+  FRAME_BOARD = 1,
+  FRAME_SCORE = 2,
+  FRAME_NEXT = 4,
+  FRAME_PAUSE = 8,
+  FRAME_ALL = 15
+} FrameChange_t;
+
+/**
+ * @brief Game frame struct
+ *
+ * Read-only view of the game info struct of a game without a copy, its
+ * version and the parts which changed after the version the view has
+ * seen. Versions only grow and only change when something a view shows
+ * has changed. The view is valid until the game is stepped next.
+ */
+typedef struct {
+  const GameInfo_t *stats;
+  uint64_t version;
+  uint32_t changed;
+} GameFrame_t;
+
+/**
+ * @brief Frame track struct
+ *
+ * Kept by a game to version its frames: the current version, the version
+ * every part last changed at and the HUD numbers, next figure and pause
+ * type of the current version to compare the next frame with.
+ */
+typedef struct {
+  uint64_t version;
+  uint64_t changed_at[FRAME_PARTS];
+  int score;
+  int high_score;
+  int level;
+  int speed;
+  int next[BRICK_SIDE][BRICK_SIDE];
+  int pause;
+} FrameTrack_t;
+
+/**
+ * @brief Frame track
+ *
+ * Compares the game info struct with the current version and makes a new
+ * version if any part has changed. The game field is too big to compare,
+ * the game tells itself whether it has changed. The first frame is always
+ * a new version.
+ *
+ * @param track Frame track
+ * @param stats Game info struct after a step
+ * @param board_changed Whether the game field has changed
+ */
+static inline void frameTrack(FrameTrack_t *track, const GameInfo_t *stats,
+                              bool board_changed) {
+  uint32_t changed = track->version == 0 ? FRAME_ALL : 0;
+
+  if (board_changed) changed |= FRAME_BOARD;
+  if (track->score != stats->score || track->high_score != stats->high_score ||
+      track->level != stats->level || track->speed != stats->speed) {
+    changed |= FRAME_SCORE;
+    track->score = stats->score;
+    track->high_score = stats->high_score;
+    track->level = stats->level;
+    track->speed = stats->speed;
+  }
+  for (int i = 0; stats->next && i < BRICK_SIDE; i++) {
+    for (int j = 0; j < BRICK_SIDE; j++) {
+      if (track->next[i][j] != stats->next[i][j]) changed |= FRAME_NEXT;
+      track->next[i][j] = stats->next[i][j];
+    }
+  }
+  if (track->pause != stats->pause) {
+    changed |= FRAME_PAUSE;
+    track->pause = stats->pause;
+  }
+
+  if (changed) {
+    track->version++;
+    for (int i = 0; i < FRAME_PARTS; i++) {
+      if (changed & (1u << i)) track->changed_at[i] = track->version;
+    }
+  }
+}
+
+/**
+ * @brief Frame changes
+ *
+ * Tells which parts changed after the passed version.
+ *
+ * @param track Frame track
+ * @param seen Version a view has seen, 0 if it hasn't seen any
+ *
+ * @return Frame change flags
+ */
+static inline uint32_t frameChanges(const FrameTrack_t *track, uint64_t seen) {
+  uint32_t changed = 0;
+
+  for (int i = 0; i < FRAME_PARTS; i++) {
+    if (seen == 0 || track->changed_at[i] > seen) changed |= 1u << i;
+  }
+  return changed;
+}
+
+/**
+ * @brief Random number generator struct
+ *
+ * State of a small PCG32 generator. Every game owns one, so games
+ * never share random state and the same seed always gives the same game.
+ */
+typedef struct {
+  uint64_t state;
+  uint64_t inc;
+} Rng_t;
+
+/**
+ * @brief Next random number
+ *
+ * Advances the generator and returns its next output.
+ *
+ * @param rng Random number generator
+ *
+ * @return Uniformly distributed 32-bit number
+ */
+static inline uint32_t rngNext(Rng_t *rng) {
+  uint64_t old = rng->state;
+  uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+  uint32_t rot = (uint32_t)(old >> 59u);
+
+  rng->state = old * 6364136223846793005ULL + rng->inc;
+  return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+/**
+ * @brief Seed random number generator
+ *
+ * Sets the generator to the start of the sequence of the given seed.
+ *
+ * @param rng Random number generator
+ * @param seed Seed
+ */
+static inline void rngSeed(Rng_t *rng, uint64_t seed) {
+  rng->state = 0;
+  rng->inc = 0xda3e39cb94b95bdbULL << 1u | 1u;
+  rngNext(rng);
+  rng->state += seed;
+  rngNext(rng);
+}
+
+/**
+ * @brief Bounded random number
+ *
+ * Returns a random number in [0, bound) without a division.
+ *
+ * @param rng Random number generator
+ * @param bound Upper bound
+ *
+ * @return Random number less than bound
+ */
+static inline uint32_t rngBounded(Rng_t *rng, uint32_t bound) {
+  return (uint32_t)(((uint64_t)rngNext(rng) * bound) >> 32);
+}
+
+/**
+ * @brief Zobrist key
+ *
+ * Returns the random key of a part of a game state, such as a filled
+ * cell or the kind of a figure, by its index. Keys are the splitmix64
+ * finalizer of the index, so they need no table and are the same in
+ * every build and run.
+ *
+ * @param index Index of the part
+ *
+ * @return Key
+ */
+static inline uint64_t zobristKey(uint64_t index) {
+  uint64_t key = (index + 1) * 0x9e3779b97f4a7c15ULL;
+
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+  return key ^ (key >> 31);
+}
+
+/**
+ * @brief Zobrist row
+ *
+ * Returns the xor of the keys of the given cells of a field row. Cell
+ * (x, y) has the index y * FIELD_WIDTH + x.
+ *
+ * @param y Row
+ * @param cells Cells of the row, bit x is column x
+ *
+ * @return Xor of the keys
+ */
+static inline uint64_t zobristRow(int y, uint32_t cells) {
+  uint64_t hash = 0;
+
+  for (; cells; cells &= cells - 1)
+    hash ^= zobristKey((uint64_t)(y * FIELD_WIDTH + __builtin_ctz(cells)));
+  return hash;
+}
+
+/**
+ * @brief Input struct
+ *
+ * A user action together with its hold flag and the time in
+ * milliseconds it was made at.
+ */
+typedef struct {
+  UserAction_t action;
+  bool hold;
+  int64_t time;
+} Input_t;
+
+/**
+ * @brief Input queue struct
+ *
+ * Bounded lock-free ring of inputs from one producer thread to one
+ * consumer thread. Inputs are kept in the order they were made, the ones
+ * which don't fit into a full queue are dropped and counted.
+ */
+typedef struct {
+  Input_t items[INPUT_QUEUE_SIZE];
+  uint32_t head;
+  uint32_t tail;
+  uint64_t dropped;
+} InputQueue_t;
+
+/**
+ * @brief Input push
+ *
+ * Appends an input to the queue, called by the producer.
+ *
+ * @param queue Input queue
+ * @param input Input to append
+ *
+ * @return Whether the input was appended, false if it was dropped
+ */
+static inline bool inputPush(InputQueue_t *queue, Input_t input) {
+  uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+  bool pushed =
+      tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) < INPUT_QUEUE_SIZE;
+
+  if (pushed) {
+    queue->items[tail % INPUT_QUEUE_SIZE] = input;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+  } else {
+    __atomic_fetch_add(&queue->dropped, 1, __ATOMIC_RELAXED);
+  }
+  return pushed;
+}
+
+/**
+ * @brief Input pop
+ *
+ * Takes the oldest input from the queue, called by the consumer.
+ *
+ * @param queue Input queue
+ * @param input Taken input
+ *
+ * @return Whether an input was taken, false if the queue is empty
+ */
+static inline bool inputPop(InputQueue_t *queue, Input_t *input) {
+  uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+  bool popped = head != __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+  if (popped) {
+    *input = queue->items[head % INPUT_QUEUE_SIZE];
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+  }
+  return popped;
+}
+
+/**
+ * @brief Input pending
+ *
+ * @param queue Input queue
+ *
+ * @return Whether the queue holds any input
+ */
+static inline bool inputPending(InputQueue_t *queue) {
+  return __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) !=
+         __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Repeat struct
+ *
+ * Engine-side auto-repeat of held actions: the set of held actions,
+ * one bit per action, whether an action is being repeated, the action,
+ * the time of its next repeat and the delays in milliseconds before the
+ * first repeat and between two repeats. Repeats follow the game clock,
+ * so they don't depend on the keyboard repeat rate of the host.
+ */
+typedef struct {
+  uint32_t held;
+  bool active;
+  UserAction_t action;
+  int64_t next_at;
+  int delay;
+  int interval;
+} Repeat_t;
+
+/**
+ * @brief Repeat set
+ *
+ * Sets the delays of auto-repeat. The interval is at least 1 ms.
+ *
+ * @param repeat Auto-repeat
+ * @param delay Delay before the first repeat in milliseconds
+ * @param interval Delay between two repeats in milliseconds
+ */
+static inline void repeatSet(Repeat_t *repeat, int delay, int interval) {
+  repeat->delay = delay > 0 ? delay : 0;
+  repeat->interval = interval > 1 ? interval : 1;
+}
+
+/**
+ * @brief Repeat input
+ *
+ * Tracks a press (hold is set) or a release of an action. A press of
+ * an action which is already held and a release aren't applied, a
+ * release of an action which isn't held is a tap and is applied. A press
+ * of a repeatable action starts to repeat it after the delay, its
+ * release stops the repeat.
+ *
+ * @param repeat Auto-repeat
+ * @param input Pressed or released action
+ * @param repeatable Whether the action repeats while held
+ *
+ * @return Whether the action has to be applied
+ */
+static inline bool repeatInput(Repeat_t *repeat, Input_t input,
+                               bool repeatable) {
+  uint32_t bit = 1u << input.action;
+  bool apply = !(repeat->held & bit);
+
+  if (input.hold) {
+    repeat->held |= bit;
+    if (apply && repeatable) {
+      repeat->active = true;
+      repeat->action = input.action;
+      repeat->next_at = input.time + repeat->delay;
+    }
+  } else if (!apply) {
+    repeat->held &= ~bit;
+    if (repeat->action == input.action) repeat->active = false;
+  }
+  return apply;
+}
+
+/**
+ * @brief Plan config struct
+ *
+ * Settings of the planning mode of the bot: how many placements of every
+ * piece are kept in the beam of the lookahead search, on how many
+ * threads the search runs and its budget for a single move, placements
+ * searched and milliseconds, 0 for no limit.
+ */
+typedef struct {
+  int beam;
+  int threads;
+  long nodes;
+  int time_ms;
+} PlanConfig_t;
+
+/**
+ * @brief Game handle
+ *
+ * Opaque handle of a single game instance. Every instance owns all of its
+ * state, so any number of games can run side by side, one per thread or
+ * many per thread.
+ *
+ * Games run off a millisecond clock: gravity and snake movement happen
+ * at fixed deadlines, INITIAL_TIMEOUT / speed apart (half of it for the
+ * snake), however often a game is stepped. gameStep() uses the monotonic
+ * clock of gameTime(), gameStepAt() takes the time from the caller, e.g.
+ * a virtual one. gameDeadline() tells when the next step is due, so a
+ * front-end can sleep until then or until user input.
+ *
+ * Inputs are queued rather than overwritten, every step applies all of
+ * the inputs queued since the previous one in order. gameInput() may be
+ * called from another thread than the one stepping the game. With hold
+ * set an input is a press, without it a release of a pressed action or
+ * else a tap. Held lateral moves of tetris and the snake's acceleration
+ * auto-repeat, gameSetRepeat() sets their delays.
+ *
+ * gameFrame() gives views the game info struct without a copy, together
+ * with a version and the parts changed since the version they have seen,
+ * so a view has nothing to do if the version hasn't changed.
+ *
+ * gameAutoplay() tells the action a built-in bot would make now, so
+ * a game can be played by passing it to gameInput() tick by tick.
+ * gameSetPlanning() makes the tetris bot look ahead over the preview
+ * with a beam search, the snake has no planning mode.
+ *
+ * gameHash() gives a 64-bit Zobrist hash of the game position: the board
+ * with the moving figure on it, the kinds of the figure and of the next
+ * one, or the snake's body and the apple. It is kept up to date with every
+ * change of the position rather than computed over the field, so it is
+ * free to take after every step, e.g. for caches, deduplication or replay
+ * checks. Built with HASH_DEBUG, every step checks it against a hash
+ * computed from scratch.
+ *
+ * gameLines() gives the lines removed so far in tetris, or the apples
+ * eaten by the snake, which the game info struct doesn't hold.
+ */
+typedef struct Game Game_t;
+
+Game_t *gameCreate(uint64_t seed);
+void gameStep(Game_t *game);
+void gameStepAt(Game_t *game, int64_t now);
+int64_t gameDeadline(Game_t *game);
+int64_t gameTime();
+void gameInput(Game_t *game, UserAction_t action, bool hold);
+void gameInputAt(Game_t *game, UserAction_t action, bool hold, int64_t time);
+uint64_t gameDroppedInputs(Game_t *game);
+void gameSetRepeat(Game_t *game, int delay, int interval);
+GameInfo_t gameSnapshot(Game_t *game);
+GameFrame_t gameFrame(Game_t *game, uint64_t seen);
+UserAction_t gameAutoplay(Game_t *game);
+int gameSetPlanning(Game_t *game, const PlanConfig_t *config);
+uint64_t gameHash(Game_t *game);
+int gameLines(Game_t *game);
+void gameDestroy(Game_t *game);
+
 GameInfo_t updateCurrentState();
 void userInput(UserAction_t action, bool hold);
 
 GameInfo_t getStats();
+GameFrame_t getFrame(uint64_t seen);
+int64_t getDeadline();
+uint64_t getDroppedInputs();
+void setRepeat(int delay, int interval);
+UserAction_t getAutoplay();
+int setPlanning(const PlanConfig_t *config);
+uint64_t getHash();
 void memFree();
 
 #ifdef __cplusplus
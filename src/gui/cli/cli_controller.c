@@ -12,7 +12,7 @@
  * @param user_input The code of the user's pressed key.
  */
 void processSignal(int user_input) {
-  GameInfo_t stats = getStats();
+  int pause = getFrame(0).stats->pause;
   UserAction_t result;
 
   switch (user_input) {
@@ -54,12 +54,12 @@ void processSignal(int user_input) {
       result = Up;
   }
 
-  if (stats.pause == GAMELOST) {
+  if (pause == GAMELOST) {
     if (user_input == 'q' || user_input == 'Q')
       result = Terminate;
     else if (user_input != ENTER_KEY)
       result = Up;
-  } else if (stats.pause == STARTING) {
+  } else if (pause == STARTING) {
     if (user_input == 'q' || user_input == 'Q')
       result = Terminate;
     else if (user_input != ENTER_KEY)
@@ -68,3 +68,55 @@ void processSignal(int user_input) {
 
   userInput(result, false);
 }
+
+/**
+ * @brief Get autoplay state
+ *
+ * Declares a static autoplay struct one time and returns it
+ * every time this function is called.
+ *
+ * @return Autoplay structure
+ */
+Autoplay_t *getAutoplayState() {
+  static Autoplay_t autoplay;
+
+  return &autoplay;
+}
+
+/**
+ * @brief Autoplay deadline
+ *
+ * Brings the game's deadline forward to the bot's next action, if the bot
+ * is enabled.
+ *
+ * @param deadline Deadline of the game, NO_DEADLINE if there is none
+ *
+ * @return Time in milliseconds to wake up at, NO_DEADLINE if there is none
+ */
+int64_t autoplayDeadline(int64_t deadline) {
+  Autoplay_t *autoplay = getAutoplayState();
+
+  if (autoplay->enabled &&
+      (deadline == NO_DEADLINE || autoplay->next_at < deadline))
+    deadline = autoplay->next_at;
+  return deadline;
+}
+
+/**
+ * @brief Process autoplay
+ *
+ * Passes the bot's action to the game model when its time has come.
+ * The bot acts every AUTOPLAY_INTERVAL milliseconds, so its play can be
+ * followed on the screen.
+ */
+void processAutoplay() {
+  Autoplay_t *autoplay = getAutoplayState();
+  int64_t now = gameTime();
+
+  if (autoplay->enabled && now >= autoplay->next_at) {
+    UserAction_t action = getAutoplay();
+
+    if (action != Up) userInput(action, false);
+    autoplay->next_at = now + AUTOPLAY_INTERVAL;
+  }
+}
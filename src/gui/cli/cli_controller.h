@@ -3,6 +3,24 @@
 
 #include "../../common.h"
 
+#define AUTOPLAY_INTERVAL 100
+#define PLANNING_BEAM 8
+#define PLANNING_TIME_MS 20
+
+/**
+ * @brief Autoplay struct
+ *
+ * The built-in bot playing instead of the user: whether it's enabled
+ * and the time in milliseconds of its next action.
+ */
+typedef struct {
+  int enabled;
+  int64_t next_at;
+} Autoplay_t;
+
 void processSignal(int user_input);
+Autoplay_t *getAutoplayState();
+int64_t autoplayDeadline(int64_t deadline);
+void processAutoplay();
 
 #endif
@@ -0,0 +1,49 @@
+#include "cli_view.h"
+
+/// @file
+/**
+ * @brief Entry point
+ *
+ * Execution of the program
+ * starts here.
+ *
+ * With the -b argument the terminal traffic of the drawn frames and
+ * the dropped inputs are counted and printed on exit. With the -s path
+ * argument the high score is kept in the given file. With the -a argument
+ * the game is played by its built-in bot, with the -l argument by the bot
+ * looking ahead over the preview within a real-time budget per move,
+ * where the game has a planning mode. With the -j n argument the lookahead
+ * searches on n threads.
+ *
+ * @param argc Number of arguments
+ * @param argv List of arguments
+ *
+ * @return Program exit status
+ */
+int main(int argc, char **argv) {
+  PlanConfig_t plan = {PLANNING_BEAM, 1, 0, PLANNING_TIME_MS};
+  int planning = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-b") == 0)
+      get_traffic()->enabled = written_bytes() >= 0;
+    else if (strcmp(argv[i], "-a") == 0)
+      getAutoplayState()->enabled = 1;
+    else if (strcmp(argv[i], "-l") == 0) {
+      getAutoplayState()->enabled = 1;
+      planning = 1;
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+      plan.threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+      highScoreSetPath(argv[++i]);
+  }
+  if (planning) planning = setPlanning(&plan) == 0;
+
+  initwin();
+  game_loop();
+  endwin();
+  if (planning) setPlanning(NULL);
+  print_traffic();
+
+  return 0;
+}
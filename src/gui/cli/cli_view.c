@@ -1,25 +1,6 @@
 #include "cli_view.h"
 
 /// @file
-/**
- * @brief Entry point
- *
- * Execution of the program
- * starts here.
- *
- * @param argc Number of arguments
- * @param argv List of arguments
- *
- * @return Program exit status
- */
-int main() {
-  initwin();
-  game_loop();
-  endwin();
-
-  return 0;
-}
-
 /**
  * @brief initwin
  *
@@ -37,22 +18,79 @@ void initwin() {
 /**
  * @brief Game loop
  *
- * Loops the game, updating the game, processing user inputs
- * and drawing the game each time cycle.
+ * Loops the game: waits for user input or the game's next deadline,
+ * queues every pressed key, updates the game and draws what has changed
+ * on the screen. If the frame version hasn't changed, nothing is drawn.
+ * With autoplay the bot's actions are queued the same way.
+ * Waiting for input the program sleeps, so the start, pause and
+ * gameover screens cost no CPU. A resize redraws everything.
  */
 void game_loop() {
-  GameInfo_t stats = updateCurrentState();
+  Frame_t frame;
+  GameFrame_t shown;
+
+  memset(&frame, 0, sizeof(frame));
+  updateCurrentState();
+  shown = getFrame(0);
+  while (shown.stats->pause != GAMEEXIT) {
+    if (shown.changed || !frame.valid)
+      print_frame(&frame, shown.stats, shown.changed);
 
-  while (stats.pause != GAMEEXIT) {
-    int signal = getch();
-    processSignal(signal);
+    int signal = wait_input(autoplayDeadline(getDeadline()));
+    while (signal != ERR) {
+      if (signal == KEY_RESIZE) frame.valid = 0;
+      processSignal(signal);
+      signal = getch();
+    }
+    processAutoplay();
 
-    stats = updateCurrentState();
+    updateCurrentState();
+    shown = getFrame(shown.version);
+  }
+}
 
-    if (stats.pause != GAMEEXIT) {
-      printAll(&stats);
+/**
+ * @brief Wait input
+ *
+ * Blocks until a key is pressed or the deadline comes.
+ *
+ * @param deadline Time in milliseconds to wake up at, NO_DEADLINE to wait
+ * for a key only
+ *
+ * @return The code of the pressed key or ERR if there is none
+ */
+int wait_input(int64_t deadline) {
+  int signal = getch();
+
+  if (signal == ERR) {
+    struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+    int timeout = -1;
+
+    if (deadline != NO_DEADLINE) {
+      int64_t left = deadline - gameTime();
+      timeout = left > 0 ? (int)left : 0;
     }
-    usleep(5000);
+    if (timeout != 0 && poll(&fd, 1, timeout) != 0) signal = getch();
+  }
+
+  return signal;
+}
+
+/**
+ * @brief Frame store
+ *
+ * Remembers the game field as the last drawn frame, if it has changed.
+ *
+ * @param frame Last drawn frame
+ * @param stats Basic game structure, passed from game model
+ * @param changed Frame change flags since the last drawn frame
+ */
+void frame_store(Frame_t *frame, const GameInfo_t *stats, uint32_t changed) {
+  frame->valid = 1;
+  frame->has_next = stats->next != NULL;
+
+  for (int i = 0; (changed & FRAME_BOARD) && i < FIELD_HEIGHT; i++) {
+    memcpy(frame->field[i], stats->field[i], sizeof(frame->field[i]));
   }
 }
 
@@ -93,7 +131,7 @@ void print_rectangle(int top_y, int bottom_y, int left_x, int right_x) {
  *
  * @param stats Basic game structure, passed from game model
  */
-void print_overlay(GameInfo_t *stats) {
+void print_overlay(const GameInfo_t *stats) {
   print_rectangle(0, FIELD_HEIGHT + 1, 1, FIELD_WIDTH * 2 + 2);
   print_rectangle(0, FIELD_HEIGHT + 1, FIELD_WIDTH * 2 + 3,
                   FIELD_WIDTH * 2 + HUD_WIDTH + 2);
@@ -117,19 +155,24 @@ void print_overlay(GameInfo_t *stats) {
  * @brief Print stats
  *
  * Prints game stats, including score, highscore, level, speed
- * and next figure (in tetris only).
+ * and next figure (in tetris only). Numbers are padded and empty cells
+ * of the next figure are blanked, so old values are overwritten. Only
+ * the middle rows of the next figure lie inside its box, the top and
+ * bottom ones share their screen rows with its borders, so only filled
+ * cells are printed there.
  *
  * @param stats Basic game structure, passed from game model
  */
-void print_stats(GameInfo_t *stats) {
-  MVPRINTW(3, FIELD_WIDTH * 2 + 7, "%d", stats->score);
-  MVPRINTW(7, FIELD_WIDTH * 2 + 7, "%d", stats->high_score);
-  MVPRINTW(10, FIELD_WIDTH * 2 + 11, "%d", stats->level);
-  MVPRINTW(13, FIELD_WIDTH * 2 + 11, "%d", stats->speed);
-  for (int i = 0; i < BRICK_SIDE; i++) {
+void print_stats(const GameInfo_t *stats) {
+  MVPRINTW(3, FIELD_WIDTH * 2 + 7, "%-6d", stats->score);
+  MVPRINTW(7, FIELD_WIDTH * 2 + 7, "%-6d", stats->high_score);
+  MVPRINTW(10, FIELD_WIDTH * 2 + 11, "%-2d", stats->level);
+  MVPRINTW(13, FIELD_WIDTH * 2 + 11, "%-2d", stats->speed);
+  for (int i = 0; stats->next && i < BRICK_SIDE; i++) {
     for (int j = 0; j < BRICK_SIDE; j++) {
-      if (stats->next && stats->next[i][j])
-        MVPRINTW(i + HUD_WIDTH + 4, 2 * j + HUD_WIDTH + 13, "%s", "[]");
+      if (stats->next[i][j] || (i > 0 && i < BRICK_SIDE - 1))
+        print_cell(i + HUD_WIDTH + 4, 2 * j + HUD_WIDTH + 13,
+                   stats->next[i][j]);
     }
   }
 }
@@ -138,28 +181,68 @@ void print_stats(GameInfo_t *stats) {
  * @brief Print everything
  *
  * Prints game overlay, stats, field, states (such as pause and gameover),
- * and controls.
+ * and controls. The whole screen is redrawn, it's only needed for the
+ * first frame and after a resize.
  *
  * @param stats Basic game structure, passed from game model
  */
-void printAll(GameInfo_t *stats) {
+void printAll(const GameInfo_t *stats) {
   erase();
   print_overlay(stats);
   print_stats(stats);
   print_field(stats);
-  if (stats->pause == STARTING) {
-    print_start();
-  } else if (stats->pause == PAUSED) {
-    print_pause();
-  } else if (stats->pause == GAMELOST) {
-    print_gameover();
-  } else if (stats->pause == GAMEWON) {
-    print_gameoverwon();
-  }
+  print_state(stats);
   print_controls();
   refresh();
 }
 
+/**
+ * @brief Print frame
+ *
+ * Draws a new frame over the last drawn one: only the changed parts are
+ * looked at, and of the field only cells which differ from the last
+ * frame are printed. The overlay and controls are left as they are.
+ * A change of the state redraws the field under the state screen.
+ * If there is no last frame, everything is drawn.
+ *
+ * Bytes written to the terminal are counted if counting is enabled,
+ * as the bytes this thread writes while drawing the frame.
+ *
+ * @param frame Last drawn frame, updated to the new one
+ * @param stats Basic game structure, passed from game model
+ * @param changed Frame change flags since the last drawn frame
+ */
+void print_frame(Frame_t *frame, const GameInfo_t *stats, uint32_t changed) {
+  Traffic_t *traffic = get_traffic();
+  long long written = traffic->enabled ? written_bytes() : 0;
+
+  if (!frame->valid || frame->has_next != (stats->next != NULL)) {
+    printAll(stats);
+    changed = FRAME_ALL;
+  } else {
+    int state_changed = changed & FRAME_PAUSE;
+
+    for (int i = 0; (changed & (FRAME_BOARD | FRAME_PAUSE)) && i < FIELD_HEIGHT;
+         i++) {
+      for (int j = 0; j < FIELD_WIDTH; j++) {
+        if (state_changed || frame->field[i][j] != stats->field[i][j])
+          print_cell(i + 1, 2 * j + 2, stats->field[i][j]);
+      }
+    }
+    if (changed & (FRAME_SCORE | FRAME_NEXT)) print_stats(stats);
+    if (state_changed) print_state(stats);
+    refresh();
+  }
+  frame_store(frame, stats, changed);
+
+  if (traffic->enabled) {
+    written = written_bytes() - written;
+    traffic->frames++;
+    traffic->bytes += written;
+    if (written > traffic->max_bytes) traffic->max_bytes = written;
+  }
+}
+
 /**
  * @brief Print field
  *
@@ -168,7 +251,7 @@ void printAll(GameInfo_t *stats) {
  *
  * @param stats Basic game structure, passed from game model
  */
-void print_field(GameInfo_t *stats) {
+void print_field(const GameInfo_t *stats) {
   for (int i = 0; i < FIELD_HEIGHT; i++) {
     for (int j = 0; j < FIELD_WIDTH; j++) {
       if (stats->field[i][j]) MVPRINTW(i + 1, 2 * j + 2, "%s", "[]");
@@ -176,6 +259,39 @@ void print_field(GameInfo_t *stats) {
   }
 }
 
+/**
+ * @brief Print cell
+ *
+ * Prints a filled or an empty cell by passed coordinates.
+ *
+ * @param y Y coordinate
+ * @param x X coordinate
+ * @param filled Is the cell filled or not
+ */
+void print_cell(int y, int x, int filled) {
+  MVPRINTW(y, x, "%s", filled ? "[]" : "  ");
+}
+
+/**
+ * @brief Print state
+ *
+ * Prints the screen of the current state over the field: start, pause,
+ * gameover or game won. Nothing is printed while playing.
+ *
+ * @param stats Basic game structure, passed from game model
+ */
+void print_state(const GameInfo_t *stats) {
+  if (stats->pause == STARTING) {
+    print_start();
+  } else if (stats->pause == PAUSED) {
+    print_pause();
+  } else if (stats->pause == GAMELOST) {
+    print_gameover();
+  } else if (stats->pause == GAMEWON) {
+    print_gameoverwon();
+  }
+}
+
 /**
  * @brief Print start
  *
@@ -250,3 +366,61 @@ void print_controls() {
   mvaddstr(8, 38, "P Pause");
   mvaddstr(9, 38, "Q Quit");
 }
+
+/**
+ * @brief Get traffic
+ *
+ * Declares a static traffic struct one time and returns it
+ * every time this function is called.
+ *
+ * @return Traffic structure
+ */
+Traffic_t *get_traffic() {
+  static Traffic_t traffic;
+
+  return &traffic;
+}
+
+/**
+ * @brief Written bytes
+ *
+ * Reads the number of bytes the calling thread has written so far.
+ * The thread drawing the frames writes nothing but the terminal, while
+ * the high score and the leaderboard are written by the writer thread,
+ * so the difference around a frame is its terminal traffic. The counter
+ * of the whole process would count those writes as well.
+ *
+ * @return Number of bytes or -1 if it can't be read (Linux only)
+ */
+long long written_bytes() {
+  long long bytes = -1;
+  FILE *fp = fopen("/proc/thread-self/io", "r");
+
+  if (fp) {
+    char line[64];
+    while (bytes < 0 && fgets(line, sizeof(line), fp)) {
+      if (sscanf(line, "wchar: %lld", &bytes) != 1) bytes = -1;
+    }
+    fclose(fp);
+  }
+
+  return bytes;
+}
+
+/**
+ * @brief Print traffic
+ *
+ * Prints the counted terminal traffic and the number of dropped
+ * inputs to stderr. Called after the ncurses window is closed.
+ */
+void print_traffic() {
+  Traffic_t *traffic = get_traffic();
+
+  if (traffic->frames > 0) {
+    fprintf(stderr, "frames: %ld, bytes: %lld, bytes/frame: %.1f, max: %lld\n",
+            traffic->frames, traffic->bytes,
+            (double)traffic->bytes / traffic->frames, traffic->max_bytes);
+    fprintf(stderr, "dropped inputs: %llu\n",
+            (unsigned long long)getDroppedInputs());
+  }
+}
@@ -1,11 +1,17 @@
 #ifndef CLI_VIEW_H
 #define CLI_VIEW_H
 
+#ifndef _DEFAULT_SOURCE
 #define _DEFAULT_SOURCE
+#endif
 
 #include <ncurses.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
+#include "../../brick_game/common/high_score.h"
 #include "cli_controller.h"
 
 #define MVPRINTW(y, x, ...) \
@@ -15,17 +21,51 @@
 #define FIELDS_BEGIN 2
 #define HUD_WIDTH 12
 
+/**
+ * @brief Frame struct
+ *
+ * The last drawn frame: whether there is one, a copy of its field and
+ * whether it has the next figure. What else has changed is told by the
+ * frame change flags of the game, cells are compared with the copy.
+ */
+typedef struct {
+  int valid;
+  int field[FIELD_HEIGHT][FIELD_WIDTH];
+  int has_next;
+} Frame_t;
+
+/**
+ * @brief Traffic struct
+ *
+ * Terminal traffic of the drawn frames: number of frames, total and
+ * largest number of bytes of a frame. Counted only if enabled.
+ */
+typedef struct {
+  int enabled;
+  long frames;
+  long long bytes;
+  long long max_bytes;
+} Traffic_t;
+
 void initwin();
 void game_loop();
+int wait_input(int64_t deadline);
+void frame_store(Frame_t *frame, const GameInfo_t *stats, uint32_t changed);
 void print_rectangle(int top_y, int bottom_y, int left_x, int right_x);
-void print_overlay(GameInfo_t *stats);
-void print_stats(GameInfo_t *stats);
-void printAll(GameInfo_t *stats);
-void print_field(GameInfo_t *stats);
+void print_overlay(const GameInfo_t *stats);
+void print_stats(const GameInfo_t *stats);
+void printAll(const GameInfo_t *stats);
+void print_frame(Frame_t *frame, const GameInfo_t *stats, uint32_t changed);
+void print_field(const GameInfo_t *stats);
+void print_cell(int y, int x, int filled);
+void print_state(const GameInfo_t *stats);
 void print_start();
 void print_pause();
 void print_gameover();
 void print_gameoverwon();
 void print_controls();
+Traffic_t *get_traffic();
+long long written_bytes();
+void print_traffic();
 
 #endif
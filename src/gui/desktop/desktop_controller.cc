@@ -2,20 +2,18 @@
 #include "desktop_view.h"
 
 /**
- * @brief Key press event
+ * @brief Key action
  *
- * Processes user input making it into game action and passing it
- * to game model.
+ * Turns a key into game action.
  *
- * This event is called in the game view when user presses a key.
+ * @param key Qt key code
  *
- * @param event Event of the pressed key
+ * @return User action enum, Up for keys without an action
  */
-void MainWindow::keyPressEvent(QKeyEvent *event) {
-  GameInfo_t stats = getStats();
+UserAction_t MainWindow::keyAction(int key) {
   UserAction_t result;
 
-  switch (event->key()) {
+  switch (key) {
     case Qt::Key::Key_Space:
       result = Action;
       break;
@@ -24,10 +22,6 @@ void MainWindow::keyPressEvent(QKeyEvent *event) {
       result = Down;
       break;
 
-    case Qt::Key::Key_Up:
-      result = Up;
-      break;
-
     case Qt::Key::Key_Left:
       result = Left;
       break;
@@ -42,7 +36,6 @@ void MainWindow::keyPressEvent(QKeyEvent *event) {
 
     case Qt::Key::Key_Q:
       result = Terminate;
-      this->close();
       break;
 
     case Qt::Key::Key_Enter:
@@ -54,19 +47,101 @@ void MainWindow::keyPressEvent(QKeyEvent *event) {
       result = Up;
   }
 
-  if (stats.pause == GAMELOST) {
-    if (event->key() == Qt::Key::Key_Q)
-      result = Terminate;
-    else if (event->key() != Qt::Key::Key_Enter &&
-             event->key() != Qt::Key::Key_Return)
-      result = Up;
-  } else if (stats.pause == STARTING) {
-    if (event->key() == Qt::Key::Key_Q)
-      result = Terminate;
-    else if (event->key() != Qt::Key::Key_Enter &&
-             event->key() != Qt::Key::Key_Return)
-      result = Up;
+  return result;
+}
+
+/**
+ * @brief Key press event
+ *
+ * Processes user input making it into game action and passing it
+ * to the game thread as a press. The state of the game is taken from
+ * the newest snapshot, the game itself is never touched from the GUI
+ * thread. Keyboard auto-repeat is ignored, the game repeats held
+ * actions by itself.
+ *
+ * This event is called in the game view when user presses a key.
+ *
+ * @param event Event of the pressed key
+ */
+void MainWindow::keyPressEvent(QKeyEvent *event) {
+  const Snapshot_t &stats = game.frame();
+  UserAction_t result = keyAction(event->key());
+
+  if (event->isAutoRepeat()) return;
+  if (result == Terminate) this->close();
+
+  if (stats.pause == GAMELOST || stats.pause == STARTING) {
+    if (result != Terminate && result != Start) result = Up;
+  }
+
+  if (result != Up) {
+    this->pressed |= 1u << result;
+    game.pushInput(result, true);
   }
+}
+
+/**
+ * @brief Key release event
+ *
+ * Passes the release of a pressed key to the game thread, which stops
+ * repeating its action.
+ *
+ * This event is called in the game view when user releases a key.
+ *
+ * @param event Event of the released key
+ */
+void MainWindow::keyReleaseEvent(QKeyEvent *event) {
+  UserAction_t result = keyAction(event->key());
+
+  if (!event->isAutoRepeat() && (this->pressed & (1u << result))) {
+    this->pressed &= ~(1u << result);
+    game.pushInput(result, false);
+  }
+}
+
+/**
+ * @brief Focus out event
+ *
+ * Releases every pressed key: their releases go to the widget which has
+ * the focus now and would never reach the game thread.
+ *
+ * This event is called in the game view when it loses the keyboard focus.
+ *
+ * @param event Event of the focus change
+ */
+void MainWindow::focusOutEvent(QFocusEvent *event) {
+  releaseAll();
+  QMainWindow::focusOutEvent(event);
+}
+
+/**
+ * @brief Change event
+ *
+ * Releases every pressed key when the window is deactivated, for
+ * the same reason as the focus out event: the application or another
+ * window gets the key releases.
+ *
+ * This event is called in the game view when its state changes.
+ *
+ * @param event Event of the change
+ */
+void MainWindow::changeEvent(QEvent *event) {
+  if (event->type() == QEvent::ActivationChange && !this->isActiveWindow())
+    releaseAll();
+  QMainWindow::changeEvent(event);
+}
 
-  userInput(result, false);
+/**
+ * @brief Release all
+ *
+ * Passes a release of every pressed key to the game thread, so that
+ * none of their actions is repeated any longer, and forgets them.
+ */
+void MainWindow::releaseAll() {
+  for (int action = 0; this->pressed; action++) {
+    if (this->pressed & (1u << action)) {
+      this->pressed &= ~(1u << action);
+      game.pushInput((UserAction_t)action, false);
+    }
+  }
 }
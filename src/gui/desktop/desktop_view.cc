@@ -6,18 +6,28 @@
  * @brief MainWindow Constructor
  *
  * Constructs main window object. Sets up ui, grabs keyboard,
- * connects timer and sets window title to Brickgame.
+ * connects and starts the game thread and sets window title to Brickgame.
+ *
+ * The field and the next figure are cached in images, which start
+ * empty and are updated cell by cell as the game changes.
  *
  * @param parent Parental class to inheriit from
  */
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), ui(new Ui::MainWindow) {
+    : QMainWindow(parent),
+      ui(new Ui::MainWindow),
+      boardImage(CELL_SIZE * FIELD_WIDTH, CELL_SIZE * FIELD_HEIGHT,
+                 QImage::Format_RGB32),
+      nextImage(NEXT_CELL_SIZE * BRICK_SIDE, NEXT_CELL_SIZE * BRICK_SIDE,
+                QImage::Format_ARGB32_Premultiplied) {
   ui->setupUi(this);
   grabKeyboard();
 
-  timer = new QTimer(this);
-  connect(timer, SIGNAL(timeout()), this, SLOT(timerSlot()));
-  timer->start(5);
+  boardImage.fill(cellColor(0));
+  nextImage.fill(Qt::transparent);
+
+  connect(&game, SIGNAL(frameReady()), this, SLOT(frameSlot()));
+  game.start();
 
   setWindowTitle("Brickgame");
 }
@@ -25,9 +35,12 @@ MainWindow::MainWindow(QWidget *parent)
 /**
  * @brief MainWindow Destructor
  *
- * Deletes ui on destruction.
+ * Stops the game thread and deletes ui on destruction.
  */
-MainWindow::~MainWindow() { delete ui; }
+MainWindow::~MainWindow() {
+  game.stop();
+  delete ui;
+}
 
 /**
  * @brief Entry point
@@ -52,24 +65,39 @@ int main(int argc, char *argv[]) {
  * Prints game overlay, stats, field, states (such as pause and gameover),
  * and controls.
  *
- * @param stats Basic game structure, passed from game model
+ * Only what has changed since the last call is updated: labels get new
+ * texts if their values differ, changed cells are drawn into the cached
+ * images and only their area of the window is scheduled for repainting.
+ * If the frame version is the shown one, nothing is done at all.
+ *
+ * @param frame Game snapshot, published by the game thread
  */
-void MainWindow::printAll(GameInfo_t &stats) {
-  updateStats(stats);
-  ui->GameStatus->setText("");
-  if (stats.next) {
-    ui->NextFigureLabels->setText("Next");
-  }
+void MainWindow::printAll(const Snapshot_t &frame) {
+  if (shown.version == frame.version) return;
+  shown.version = frame.version;
 
-  if (stats.pause == STARTING) {
-    printStart();
-  } else if (stats.pause == PAUSED) {
-    printPause();
-  } else if (stats.pause == GAMELOST) {
-    printGameover();
-  } else if (stats.pause == GAMEWON) {
-    printGameoverWon();
+  updateStats(frame);
+
+  if (shown.pause != frame.pause) {
+    shown.pause = frame.pause;
+    ui->GameStatus->setText("");
+    if (frame.has_next) {
+      ui->NextFigureLabels->setText("Next");
+    }
+
+    if (frame.pause == STARTING) {
+      printStart();
+    } else if (frame.pause == PAUSED) {
+      printPause();
+    } else if (frame.pause == GAMELOST) {
+      printGameover();
+    } else if (frame.pause == GAMEWON) {
+      printGameoverWon();
+    }
   }
+
+  QRect dirty = updateImages(frame);
+  if (!dirty.isNull()) update(dirty);
 }
 
 /**
@@ -116,66 +144,128 @@ void MainWindow::printGameoverWon() {
  * Updates and prints game stats, including score, highscore, level, speed
  * and next figure (in tetris only).
  *
- * @param stats Basic game structure, passed from game model
+ * @param frame Game snapshot, published by the game thread
  */
-void MainWindow::updateStats(GameInfo_t &stats) {
-  ui->ScoreLabel->setText(QString::number(stats.score));
-  ui->HighscoreLabel->setText(QString::number(stats.high_score));
-  ui->LevelLabel->setText(QString::number(stats.level));
-  ui->SpeedLabel->setText(QString::number(stats.speed));
+void MainWindow::updateStats(const Snapshot_t &frame) {
+  if (shown.score != frame.score) {
+    shown.score = frame.score;
+    ui->ScoreLabel->setText(QString::number(frame.score));
+  }
+  if (shown.high_score != frame.high_score) {
+    shown.high_score = frame.high_score;
+    ui->HighscoreLabel->setText(QString::number(frame.high_score));
+  }
+  if (shown.level != frame.level) {
+    shown.level = frame.level;
+    ui->LevelLabel->setText(QString::number(frame.level));
+  }
+  if (shown.speed != frame.speed) {
+    shown.speed = frame.speed;
+    ui->SpeedLabel->setText(QString::number(frame.speed));
+  }
 }
 
 /**
- * @brief Paint event
+ * @brief Update images
  *
- * Paints game field, cycling through every coordinate, painting a cell
- * of the field if it exists.
+ * Draws the changed cells of the field and the next figure (in tetris
+ * only) into the cached images.
  *
- * Also paints next figure (in tetris only).
+ * @param frame Game snapshot, published by the game thread
  *
- * @param * Called paint event
+ * @return Area of the window to repaint, null if nothing has changed
  */
-void MainWindow::paintEvent(QPaintEvent *) {
+QRect MainWindow::updateImages(const Snapshot_t &frame) {
+  QRect dirty;
   QPainter painter;
-  GameInfo_t stats = getStats();
-  painter.begin(this);
-  painter.setPen(Qt::NoPen);
-
-  for (int i = 0; stats.field && i < FIELD_HEIGHT; ++i) {
-    for (int j = 0; stats.field && j < FIELD_WIDTH; ++j) {
-      if (stats.field[i][j] == 1)
-        painter.setBrush(QColor{0, 200, 0});
-      else if (stats.field[i][j] == 2)
-        painter.setBrush(QColor{200, 50, 0});
-      else
-        painter.setBrush(QColor{75, 75, 75});
-
-      painter.drawRect(40 * j, 40 * i, 40, 40);
+
+  for (int i = 0; i < FIELD_HEIGHT; ++i) {
+    for (int j = 0; j < FIELD_WIDTH; ++j) {
+      if (shown.field[i][j] != frame.field[i][j]) {
+        QRect cell(CELL_SIZE * j, CELL_SIZE * i, CELL_SIZE, CELL_SIZE);
+        if (!painter.isActive()) painter.begin(&boardImage);
+        painter.fillRect(cell, cellColor(frame.field[i][j]));
+        shown.field[i][j] = frame.field[i][j];
+        dirty |= cell;
+      }
     }
   }
+  if (painter.isActive()) painter.end();
 
-  if (stats.next) {
-    painter.setBrush(QColor{0, 200, 0});
-    for (int i = 0; i < BRICK_SIDE; i++) {
-      for (int j = 0; j < BRICK_SIDE; j++) {
-        if (stats.next[i][j])
-          painter.drawRect(425 + 20 * j, 410 + 20 * i, 20, 20);
+  for (int i = 0; frame.has_next && i < BRICK_SIDE; i++) {
+    for (int j = 0; j < BRICK_SIDE; j++) {
+      if (shown.next[i][j] != frame.next[i][j] || !shown.has_next) {
+        QRect cell(NEXT_CELL_SIZE * j, NEXT_CELL_SIZE * i, NEXT_CELL_SIZE,
+                   NEXT_CELL_SIZE);
+        if (!painter.isActive()) {
+          painter.begin(&nextImage);
+          painter.setCompositionMode(QPainter::CompositionMode_Source);
+        }
+        painter.fillRect(cell, frame.next[i][j] ? cellColor(1)
+                                                : QColor(Qt::transparent));
+        shown.next[i][j] = frame.next[i][j];
+        dirty |= cell.translated(NEXT_X, NEXT_Y);
       }
     }
   }
-  painter.end();
+  if (painter.isActive()) painter.end();
+  shown.has_next = frame.has_next;
+
+  return dirty;
 }
 
 /**
- * @brief Timer slot
+ * @brief Cell color
+ *
+ * Color of a field cell: snake or figure, apple or empty.
  *
- * This slot is called every time a timeout is executed
- * from the corresponding timer.
+ * @param cell Value of the cell
  *
- * It updates the game state, repaints the field and prints stats.
+ * @return Cell color
  */
-void MainWindow::timerSlot() {
-  GameInfo_t stats = updateCurrentState();
-  repaint();
-  printAll(stats);
+QColor MainWindow::cellColor(int cell) {
+  QColor color{75, 75, 75};
+
+  if (cell == 1)
+    color = QColor{0, 200, 0};
+  else if (cell == 2)
+    color = QColor{200, 50, 0};
+
+  return color;
+}
+
+/**
+ * @brief Paint event
+ *
+ * Paints game field and next figure (in tetris only) from the cached
+ * images. Only the area asked by the event is blitted.
+ *
+ * @param event Called paint event
+ */
+void MainWindow::paintEvent(QPaintEvent *event) {
+  QPainter painter(this);
+  painter.setClipRegion(event->region());
+
+  painter.drawImage(0, 0, boardImage);
+  if (shown.has_next) painter.drawImage(NEXT_X, NEXT_Y, nextImage);
+}
+
+/**
+ * @brief Frame slot
+ *
+ * This slot is called when the game thread has published a new snapshot.
+ *
+ * It takes the newest snapshot and prints what has changed, or closes
+ * the window if the game has exited. Repainting is left to Qt, which
+ * merges all scheduled updates into one paint.
+ */
+void MainWindow::frameSlot() {
+  if (game.fetchFrame()) {
+    const Snapshot_t &frame = game.frame();
+
+    if (frame.pause == GAMEEXIT)
+      close();
+    else
+      printAll(frame);
+  }
 }
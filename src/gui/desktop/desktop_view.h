@@ -3,13 +3,42 @@
 
 #include <QBrush>
 #include <QColor>
+#include <QEvent>
+#include <QFocusEvent>
+#include <QImage>
 #include <QKeyEvent>
 #include <QMainWindow>
+#include <QPaintEvent>
 #include <QPainter>
 #include <QPen>
-#include <QTimer>
+#include <QRect>
 
 #include "../../common.h"
+#include "game_thread.h"
+
+#define CELL_SIZE 40
+#define NEXT_CELL_SIZE 20
+#define NEXT_X 425
+#define NEXT_Y 410
+
+/**
+ * @brief Shown struct
+ *
+ * Everything the window shows from the game info struct: field and next
+ * figure cells, score, highscore, level, speed, pause type and the frame
+ * version. Only the parts which differ from it are updated.
+ */
+struct Shown_t {
+  int field[FIELD_HEIGHT][FIELD_WIDTH]{};
+  int next[BRICK_SIDE][BRICK_SIDE]{};
+  int score = -1;
+  int high_score = -1;
+  int level = -1;
+  int speed = -1;
+  int pause = -1;
+  bool has_next = false;
+  uint64_t version = 0;
+};
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -29,25 +58,35 @@ class MainWindow : public QMainWindow {
   MainWindow(QWidget *parent = nullptr);
   ~MainWindow();
 
-  void printAll(GameInfo_t &stats);
-  void updateStats(GameInfo_t &stats);
+  void printAll(const Snapshot_t &frame);
+  void updateStats(const Snapshot_t &frame);
+  QRect updateImages(const Snapshot_t &frame);
+  static QColor cellColor(int cell);
   void printStart();
   void printPause();
   void printGameover();
   void printGameoverWon();
 
-  QTimer *getTimer() { return this->timer; }
-
  protected:
   void keyPressEvent(QKeyEvent *event) override;
+  void keyReleaseEvent(QKeyEvent *event) override;
+  void focusOutEvent(QFocusEvent *event) override;
+  void changeEvent(QEvent *event) override;
   void paintEvent(QPaintEvent *) override;
 
  private:
   Ui::MainWindow *ui;
-  QTimer *timer;
+  GameThread game;
+  QImage boardImage;
+  QImage nextImage;
+  Shown_t shown;
+  uint32_t pressed = 0;
+
+  static UserAction_t keyAction(int key);
+  void releaseAll();
 
  private slots:
-  void timerSlot();
+  void frameSlot();
 };
 
 #endif  // DESKTOP_VIEW_H
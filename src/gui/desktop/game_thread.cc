@@ -0,0 +1,160 @@
+#include "game_thread.h"
+
+/// @file
+/**
+ * @brief GameThread Destructor
+ *
+ * Stops the thread if it's still running.
+ */
+GameThread::~GameThread() { stop(); }
+
+/**
+ * @brief Push input
+ *
+ * Queues user's action for the game, stamped with the time it was made
+ * at, and wakes the game thread up. Called by the GUI thread. If the
+ * queue is full, the action is dropped.
+ *
+ * @param action User action enum
+ * @param hold Whether the key was pressed or released
+ */
+void GameThread::pushInput(UserAction_t action, bool hold) {
+  if (this->inputs.push(Input_t{action, hold, gameTime()})) {
+    // Taking the mutex orders the push before the game thread's check,
+    // so the wake-up can't be lost.
+    { std::lock_guard<std::mutex> lock(this->wakeMutex); }
+    this->wakeUp.notify_one();
+  }
+}
+
+/**
+ * @brief Fetch frame
+ *
+ * Takes the newest snapshot published by the game thread.
+ * Called by the GUI thread.
+ *
+ * The flag is cleared before the middle slot is looked at, and set by
+ * the game thread after it has published, all sequentially consistent:
+ * either this fetch sees the new snapshot or the game thread sees
+ * the cleared flag and notifies again, a snapshot is never left unshown.
+ *
+ * @return Whether there is a new snapshot
+ */
+bool GameThread::fetchFrame() {
+  this->notified.store(false, std::memory_order_seq_cst);
+
+  return this->frames.fetch();
+}
+
+/**
+ * @brief Stop
+ *
+ * Asks the game loop to finish and waits for the thread.
+ */
+void GameThread::stop() {
+  if (isRunning()) {
+    requestInterruption();
+    { std::lock_guard<std::mutex> lock(this->wakeMutex); }
+    this->wakeUp.notify_one();
+    QThread::wait();
+  }
+}
+
+/**
+ * @brief Run
+ *
+ * The game loop. Hands all queued inputs over to the game, steps it
+ * when there is input or its deadline comes and sleeps in between. The
+ * game applies the inputs in order, so none of them is lost between two
+ * steps. Every step which makes a new frame version is published.
+ * The loop ends when the game exits or the thread is stopped.
+ */
+void GameThread::run() {
+  Game_t *game = gameCreate(0);
+  bool running = game != nullptr;
+
+  if (running) {
+    gameStep(game);
+    publish(game);
+  }
+
+  while (running && !isInterruptionRequested()) {
+    Input_t input;
+
+    while (this->inputs.pop(input))
+      gameInputAt(game, input.action, input.hold, input.time);
+
+    int64_t deadline = gameDeadline(game);
+    if (deadline != NO_DEADLINE && deadline <= gameTime()) {
+      gameStep(game);
+      publish(game);
+    } else {
+      sleepUntil(deadline);
+    }
+
+    running = gameSnapshot(game).pause != GAMEEXIT;
+  }
+
+  gameDestroy(game);
+}
+
+/**
+ * @brief Publish
+ *
+ * Brings the back snapshot up to the newest frame version of the game,
+ * publishes it and tells the GUI about it, unless the GUI hasn't fetched
+ * the previous one yet. Only the parts changed since the snapshot's own
+ * version are copied, nothing is published if the version is the same.
+ *
+ * @param game Game handle
+ */
+void GameThread::publish(Game_t *game) {
+  Snapshot_t &frame = this->frames.back();
+  GameFrame_t shown = gameFrame(game, frame.version);
+  const GameInfo_t &stats = *shown.stats;
+
+  if (shown.version == frame.version) return;
+
+  for (int i = 0; (shown.changed & FRAME_BOARD) && stats.field &&
+                  i < FIELD_HEIGHT;
+       i++) {
+    std::copy_n(stats.field[i], FIELD_WIDTH, frame.field[i]);
+  }
+  for (int i = 0; (shown.changed & FRAME_NEXT) && stats.next && i < BRICK_SIDE;
+       i++) {
+    std::copy_n(stats.next[i], BRICK_SIDE, frame.next[i]);
+  }
+  frame.has_next = stats.next != nullptr;
+  frame.score = stats.score;
+  frame.high_score = stats.high_score;
+  frame.level = stats.level;
+  frame.speed = stats.speed;
+  frame.pause = stats.pause;
+  frame.version = shown.version;
+
+  this->frames.publish();
+  if (!this->notified.exchange(true, std::memory_order_seq_cst))
+    emit frameReady();
+}
+
+/**
+ * @brief Sleep until
+ *
+ * Sleeps until the deadline, new input or a stop request.
+ *
+ * @param deadline Time in milliseconds, NO_DEADLINE to wait for input only
+ */
+void GameThread::sleepUntil(int64_t deadline) {
+  std::unique_lock<std::mutex> lock(this->wakeMutex);
+  auto woken = [this] {
+    return !this->inputs.empty() || isInterruptionRequested();
+  };
+
+  if (deadline == NO_DEADLINE) {
+    this->wakeUp.wait(lock, woken);
+  } else {
+    auto left = std::chrono::milliseconds(deadline - gameTime());
+    this->wakeUp.wait_until(lock, std::chrono::steady_clock::now() + left,
+                            woken);
+  }
+}
@@ -0,0 +1,217 @@
+#ifndef GAME_THREAD_H
+#define GAME_THREAD_H
+
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "../../common.h"
+
+/**
+ * @brief Snapshot struct
+ *
+ * An immutable copy of the game info struct published by the game
+ * thread: field and next figure cells, score, highscore, level, speed,
+ * pause type and the frame version it is a copy of.
+ */
+struct Snapshot_t {
+  int field[FIELD_HEIGHT][FIELD_WIDTH]{};
+  int next[BRICK_SIDE][BRICK_SIDE]{};
+  bool has_next = false;
+  int score = 0;
+  int high_score = 0;
+  int level = 0;
+  int speed = 0;
+  int pause = STARTING;
+  uint64_t version = 0;
+};
+
+/**
+ * @brief TripleBuffer class
+ *
+ * Lock-free hand-off of values from one writer thread to one reader
+ * thread. The writer fills the back slot and publishes it, the reader
+ * takes the newest published slot. Neither side ever waits for the
+ * other, and the reader never sees a slot which is being written.
+ *
+ * The middle slot is exchanged and loaded sequentially consistent, so
+ * a flag the two sides set and clear around publish() and fetch()
+ * orders with it, see GameThread::fetchFrame().
+ */
+template <typename T>
+class TripleBuffer {
+ public:
+  /**
+   * @brief Back
+   *
+   * Slot owned by the writer, to be filled before publish().
+   *
+   * @return Back slot
+   */
+  T &back() { return buffers[backIndex]; }
+
+  /**
+   * @brief Publish
+   *
+   * Makes the back slot the newest one and takes a free slot as
+   * the new back slot.
+   */
+  void publish() {
+    backIndex =
+        middle.exchange(backIndex | kFresh, std::memory_order_seq_cst) &
+        kIndex;
+  }
+
+  /**
+   * @brief Fetch
+   *
+   * Takes the newest published slot as the front slot, if there is one.
+   *
+   * @return Whether a new slot was taken
+   */
+  bool fetch() {
+    bool fresh = middle.load(std::memory_order_seq_cst) & kFresh;
+
+    if (fresh)
+      frontIndex =
+          middle.exchange(frontIndex, std::memory_order_acq_rel) & kIndex;
+    return fresh;
+  }
+
+  /**
+   * @brief Front
+   *
+   * Slot owned by the reader, the newest one taken by fetch().
+   *
+   * @return Front slot
+   */
+  const T &front() const { return buffers[frontIndex]; }
+
+ private:
+  static constexpr int kIndex = 3;
+  static constexpr int kFresh = 4;
+
+  T buffers[3]{};
+  std::atomic<int> middle{1};
+  int backIndex = 0;
+  int frontIndex = 2;
+};
+
+/**
+ * @brief SpscQueue class
+ *
+ * Lock-free bounded queue from one producer thread to one consumer
+ * thread. The capacity must be a power of two.
+ */
+template <typename T, unsigned N>
+class SpscQueue {
+  static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+ public:
+  /**
+   * @brief Push
+   *
+   * Appends a value, called by the producer.
+   *
+   * @param value Value to append
+   *
+   * @return Whether the value was appended, false if the queue is full
+   */
+  bool push(T value) {
+    unsigned t = tail.load(std::memory_order_relaxed);
+    bool pushed = t - head.load(std::memory_order_acquire) < N;
+
+    if (pushed) {
+      items[t & (N - 1)] = value;
+      tail.store(t + 1, std::memory_order_release);
+    }
+    return pushed;
+  }
+
+  /**
+   * @brief Pop
+   *
+   * Takes the oldest value, called by the consumer.
+   *
+   * @param value Taken value
+   *
+   * @return Whether a value was taken, false if the queue is empty
+   */
+  bool pop(T &value) {
+    unsigned h = head.load(std::memory_order_relaxed);
+    bool popped = h != tail.load(std::memory_order_acquire);
+
+    if (popped) {
+      value = items[h & (N - 1)];
+      head.store(h + 1, std::memory_order_release);
+    }
+    return popped;
+  }
+
+  /**
+   * @brief Empty
+   *
+   * @return Whether the queue is empty
+   */
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+ private:
+  T items[N]{};
+  std::atomic<unsigned> head{0};
+  std::atomic<unsigned> tail{0};
+};
+
+/**
+ * @brief GameThread class
+ *
+ * Runs a game on its own thread. The game is stepped at its deadlines
+ * and on user input, every step is published as a snapshot for the GUI.
+ * Inputs come from the GUI through a lock-free queue, so neither thread
+ * waits for the other: a slow paint doesn't stall the game and a busy
+ * game doesn't stall the GUI.
+ */
+class GameThread : public QThread {
+  Q_OBJECT
+
+ public:
+  explicit GameThread(QObject *parent = nullptr) : QThread(parent){};
+  ~GameThread();
+
+  void pushInput(UserAction_t action, bool hold);
+  bool fetchFrame();
+
+  /**
+   * @brief Frame
+   *
+   * Newest snapshot taken by fetchFrame(). GUI thread only.
+   *
+   * @return Game snapshot
+   */
+  const Snapshot_t &frame() const { return this->frames.front(); }
+
+  void stop();
+
+ signals:
+  void frameReady();
+
+ protected:
+  void run() override;
+
+ private:
+  void publish(Game_t *game);
+  void sleepUntil(int64_t deadline);
+
+  TripleBuffer<Snapshot_t> frames;
+  SpscQueue<Input_t, INPUT_QUEUE_SIZE> inputs;
+  std::atomic<bool> notified{false};
+  std::mutex wakeMutex;
+  std::condition_variable wakeUp;
+};
+
+#endif  // GAME_THREAD_H
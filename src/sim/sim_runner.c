@@ -0,0 +1,418 @@
+#include "sim_runner.h"
+
+/// @file
+/**
+ * @brief Entry point
+ *
+ * Execution of the headless runner starts here. Plays a batch of games
+ * on all cores without rendering and prints the report. The high score
+ * is kept in memory only, batches never write it to disk.
+ *
+ * @param argc Number of arguments
+ * @param argv List of arguments
+ *
+ * @return Program exit status
+ */
+int main(int argc, char **argv) {
+  SimConfig_t config;
+  int status = parse_args(argc, argv, &config);
+
+  if (status) {
+    print_usage(argv[0]);
+  } else {
+    highScoreSetPath(NULL);
+    SimResult_t *results =
+        (SimResult_t *)calloc(config.games, sizeof(SimResult_t));
+    if (results) {
+      double start = now_seconds();
+      run_batch(&config, results);
+      print_report(&config, results, now_seconds() - start);
+      free(results);
+    } else {
+      status = 1;
+    }
+  }
+
+  return status;
+}
+
+/**
+ * @brief Parse arguments
+ *
+ * Fills the config with defaults and overrides them from the command line.
+ *
+ * @param argc Number of arguments
+ * @param argv List of arguments
+ * @param config Sim config structure
+ *
+ * @return Parsing status
+ */
+int parse_args(int argc, char **argv, SimConfig_t *config) {
+  int error = 0;
+  int opt;
+
+  config->games = SIM_DEFAULT_GAMES;
+  config->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  config->seed = 1;
+  config->max_ticks = SIM_DEFAULT_MAX_TICKS;
+  config->frame_ms = SIM_DEFAULT_FRAME_MS;
+  config->policy = POLICY_RANDOM;
+  config->script = NULL;
+  config->script_len = 0;
+  config->rate = SIM_DEFAULT_RATE;
+  config->planning = false;
+  config->plan = (PlanConfig_t){0, 1, SIM_DEFAULT_PLAN_NODES, 0};
+
+  while (!error &&
+         (opt = getopt(argc, argv, "g:t:s:m:f:r:x:al:j:n:w:")) != -1) {
+    switch (opt) {
+      case 'g':
+        config->games = atol(optarg);
+        break;
+
+      case 't':
+        config->threads = atoi(optarg);
+        break;
+
+      case 's':
+        config->seed = strtoull(optarg, NULL, 10);
+        break;
+
+      case 'm':
+        config->max_ticks = atol(optarg);
+        break;
+
+      case 'f':
+        config->frame_ms = atoi(optarg);
+        break;
+
+      case 'r':
+        config->rate = atoi(optarg);
+        break;
+
+      case 'x':
+        config->policy = POLICY_SCRIPT;
+        config->script = optarg;
+        config->script_len = strlen(optarg);
+        break;
+
+      case 'a':
+        config->policy = POLICY_AUTOPLAY;
+        break;
+
+      case 'l':
+        config->policy = POLICY_AUTOPLAY;
+        config->planning = true;
+        config->plan.beam = atoi(optarg);
+        break;
+
+      case 'j':
+        config->plan.threads = atoi(optarg);
+        break;
+
+      case 'n':
+        config->plan.nodes = atol(optarg);
+        break;
+
+      case 'w':
+        config->plan.time_ms = atoi(optarg);
+        break;
+
+      default:
+        error = 1;
+    }
+  }
+
+  if (config->threads < 1) config->threads = 1;
+  if (config->threads > SIM_MAX_THREADS) config->threads = SIM_MAX_THREADS;
+  if (config->games < 1 || config->max_ticks < 1 ||
+      config->frame_ms < 1 || config->rate < 1 ||
+      (config->policy == POLICY_SCRIPT && config->script_len == 0) ||
+      (config->planning && config->plan.beam < 1) || config->plan.threads < 1 ||
+      config->plan.nodes < 0 || config->plan.time_ms < 0)
+    error = 1;
+
+  return error;
+}
+
+/**
+ * @brief Print usage
+ *
+ * Prints command line options of the runner.
+ *
+ * @param name Program name
+ */
+void print_usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s [-g games] [-t threads] [-s seed] [-m max_ticks]\n"
+          "          [-f frame_ms] [-r rate] [-x script] [-a]\n"
+          "          [-l beam] [-j threads] [-n nodes] [-w ms]\n"
+          "  -g  number of games to play (%d)\n"
+          "  -t  number of threads (all cores)\n"
+          "  -s  seed of the first game, game i uses seed + i (1)\n"
+          "  -m  tick limit of a single game (%d)\n"
+          "  -f  virtual milliseconds between two ticks (%d)\n"
+          "  -r  random policy: one random input every N ticks on average "
+          "(%d)\n"
+          "  -x  scripted policy: inputs repeated tick by tick,\n"
+          "      L left, R right, A action, D down, anything else nothing\n"
+          "  -a  autoplay policy: the game's built-in bot\n"
+          "  -l  autoplay policy with a lookahead over the preview,\n"
+          "      keeping this many placements of every piece\n"
+          "  -j  threads of the lookahead in every game (1)\n"
+          "  -n  placements searched per move by the lookahead, 0 for "
+          "no limit (%d)\n"
+          "  -w  milliseconds of real time per move of the lookahead,\n"
+          "      0 for no limit, makes the batch depend on the load (0)\n",
+          name, SIM_DEFAULT_GAMES, SIM_DEFAULT_MAX_TICKS, SIM_DEFAULT_FRAME_MS,
+          SIM_DEFAULT_RATE, SIM_DEFAULT_PLAN_NODES);
+}
+
+/**
+ * @brief Run batch
+ *
+ * Plays all games of the batch on the configured number of threads.
+ * Threads take games one by one from a shared counter, so long games
+ * don't leave other cores idle.
+ *
+ * @param config Sim config structure
+ * @param results Result of every game, indexed by game
+ */
+void run_batch(const SimConfig_t *config, SimResult_t *results) {
+  pthread_t threads[SIM_MAX_THREADS];
+  long next_game = 0;
+  SimWorker_t worker = {config, results, &next_game};
+  int started = 0;
+
+  for (int i = 1; i < config->threads; i++) {
+    if (pthread_create(&threads[started], NULL, sim_worker, &worker) == 0)
+      started++;
+  }
+  sim_worker(&worker);
+
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+}
+
+/**
+ * @brief Sim worker
+ *
+ * Thread body: plays games until the batch is exhausted.
+ *
+ * @param arg Sim worker structure
+ *
+ * @return Nothing
+ */
+void *sim_worker(void *arg) {
+  SimWorker_t *worker = (SimWorker_t *)arg;
+  long index;
+
+  while ((index = __atomic_fetch_add(worker->next_game, 1,
+                                     __ATOMIC_RELAXED)) <
+         worker->config->games) {
+    worker->results[index] = play_game(worker->config, index);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Play game
+ *
+ * Plays a single game from start to its end or to the tick limit.
+ * The game and its policy are seeded from the game's index and the game
+ * runs on virtual time, one frame per tick, so the batch gives the same
+ * results on any number of threads and under any load.
+ *
+ * @param config Sim config structure
+ * @param index Index of the game in the batch
+ *
+ * @return Result of the game
+ */
+SimResult_t play_game(const SimConfig_t *config, long index) {
+  SimResult_t result = {0, 0, 0};
+  uint64_t seed = config->seed + (uint64_t)index;
+  Game_t *game = gameCreate(seed);
+  Rng_t rng;
+  int64_t now = 0;
+
+  rngSeed(&rng, seed ^ SIM_POLICY_STREAM);
+  if (game && config->planning) gameSetPlanning(game, &config->plan);
+  if (game) {
+    gameInputAt(game, Start, false, now);
+    gameStepAt(game, now);
+
+    GameInfo_t stats = gameSnapshot(game);
+    while (stats.pause == PLAYING && result.ticks < config->max_ticks) {
+      UserAction_t action = next_action(config, game, &rng, result.ticks);
+      gameInputAt(game, action, false, now);
+      now += config->frame_ms;
+      gameStepAt(game, now);
+      stats = gameSnapshot(game);
+      result.ticks++;
+    }
+
+    result.score = stats.score;
+    result.dropped = (long)gameDroppedInputs(game);
+    gameDestroy(game);
+  }
+
+  return result;
+}
+
+/**
+ * @brief Next action
+ *
+ * Asks the policy for the input of the current tick.
+ *
+ * @param config Sim config structure
+ * @param game Game handle, asked by the autoplay policy
+ * @param rng Random number generator of the policy
+ * @param tick Current tick of the game
+ *
+ * @return User action, Up if there is no input
+ */
+UserAction_t next_action(const SimConfig_t *config, Game_t *game, Rng_t *rng,
+                         long tick) {
+  static const UserAction_t actions[] = {Left, Right, Action, Down};
+  UserAction_t action = Up;
+
+  if (config->policy == POLICY_AUTOPLAY) {
+    action = gameAutoplay(game);
+  } else if (config->policy == POLICY_SCRIPT) {
+    action = script_action(config->script[tick % config->script_len]);
+  } else if (rngBounded(rng, config->rate) == 0) {
+    action = actions[rngBounded(rng, 4)];
+  }
+
+  return action;
+}
+
+/**
+ * @brief Script action
+ *
+ * Maps a character of the script to a user action.
+ *
+ * @param c Script character
+ *
+ * @return User action, Up if there is no input
+ */
+UserAction_t script_action(char c) {
+  UserAction_t action;
+
+  switch (c) {
+    case 'L':
+      action = Left;
+      break;
+
+    case 'R':
+      action = Right;
+      break;
+
+    case 'A':
+      action = Action;
+      break;
+
+    case 'D':
+      action = Down;
+      break;
+
+    default:
+      action = Up;
+  }
+
+  return action;
+}
+
+/**
+ * @brief Compare results
+ *
+ * Orders results by score for qsort().
+ *
+ * @param a First result
+ * @param b Second result
+ *
+ * @return Comparison result
+ */
+int compare_results(const void *a, const void *b) {
+  int first = ((const SimResult_t *)a)->score;
+  int second = ((const SimResult_t *)b)->score;
+
+  return (first > second) - (first < second);
+}
+
+/**
+ * @brief Compare ticks
+ *
+ * Orders results by game length for qsort().
+ *
+ * @param a First result
+ * @param b Second result
+ *
+ * @return Comparison result
+ */
+int compare_ticks(const void *a, const void *b) {
+  long first = ((const SimResult_t *)a)->ticks;
+  long second = ((const SimResult_t *)b)->ticks;
+
+  return (first > second) - (first < second);
+}
+
+/**
+ * @brief Print report
+ *
+ * Prints throughput of the batch, distributions of game lengths and
+ * scores and the total of dropped inputs. Sorts the results by game
+ * length, then by score.
+ *
+ * @param config Sim config structure
+ * @param results Result of every game
+ * @param seconds Wall time of the batch
+ */
+void print_report(const SimConfig_t *config, SimResult_t *results,
+                  double seconds) {
+  long games = config->games;
+  double ticks = 0;
+  double score = 0;
+  long capped = 0;
+  long dropped = 0;
+
+  for (long i = 0; i < games; i++) {
+    ticks += results[i].ticks;
+    score += results[i].score;
+    if (results[i].ticks >= config->max_ticks) capped++;
+    dropped += results[i].dropped;
+  }
+
+  printf("games       %ld (%ld hit the tick limit)\n", games, capped);
+  printf("threads     %d\n", config->threads);
+  printf("wall time   %.3f s\n", seconds);
+  printf("games/sec   %.1f\n", games / seconds);
+  printf("ticks/sec   %.0f\n", ticks / seconds);
+  printf("dropped     %ld inputs\n", dropped);
+  qsort(results, games, sizeof(SimResult_t), compare_ticks);
+  printf("ticks       min %ld  p50 %ld  p90 %ld  p99 %ld  max %ld  mean %.1f\n",
+         results[0].ticks, results[games / 2].ticks,
+         results[games * 9 / 10].ticks, results[games * 99 / 100].ticks,
+         results[games - 1].ticks, ticks / games);
+  qsort(results, games, sizeof(SimResult_t), compare_results);
+  printf("score       min %d  p50 %d  p90 %d  p99 %d  max %d  mean %.2f\n",
+         results[0].score, results[games / 2].score,
+         results[games * 9 / 10].score, results[games * 99 / 100].score,
+         results[games - 1].score, score / games);
+}
+
+/**
+ * @brief Now seconds
+ *
+ * Reads the monotonic clock.
+ *
+ * @return Current time in seconds
+ */
+double now_seconds() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,92 @@
+#ifndef SIM_RUNNER_H
+#define SIM_RUNNER_H
+
+#define _DEFAULT_SOURCE
+
+/// @file
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../brick_game/common/high_score.h"
+#include "../common.h"
+
+#define SIM_DEFAULT_GAMES 1000
+#define SIM_DEFAULT_MAX_TICKS 10000000
+#define SIM_DEFAULT_RATE 8
+#define SIM_DEFAULT_FRAME_MS 5
+#define SIM_DEFAULT_PLAN_NODES 0
+#define SIM_MAX_THREADS 256
+#define SIM_POLICY_STREAM 0x9e3779b97f4a7c15ULL
+
+/**
+ * @brief Policy enum
+ *
+ * Enumeration of the possible sources of simulated user input.
+ */
+typedef enum { POLICY_RANDOM = 0, POLICY_SCRIPT, POLICY_AUTOPLAY } SimPolicy_t;
+
+/**
+ * @brief Sim config struct
+ *
+ * Holds the batch settings: number of games and threads, base seed,
+ * tick limit of a single game, virtual time of a tick, input policy,
+ * policy script with its length, the rate of random inputs and whether
+ * the bot plans ahead, with the plan config it does it with.
+ */
+typedef struct {
+  long games;
+  int threads;
+  uint64_t seed;
+  long max_ticks;
+  int frame_ms;
+  SimPolicy_t policy;
+  const char *script;
+  size_t script_len;
+  int rate;
+  bool planning;
+  PlanConfig_t plan;
+} SimConfig_t;
+
+/**
+ * @brief Sim result struct
+ *
+ * Result of a single simulated game: final score, number of ticks and
+ * number of inputs dropped by the game's input queue.
+ */
+typedef struct {
+  int score;
+  long ticks;
+  long dropped;
+} SimResult_t;
+
+/**
+ * @brief Sim worker struct
+ *
+ * Everything a worker thread needs: the config, the results array
+ * and the shared counter of the next game to play.
+ */
+typedef struct {
+  const SimConfig_t *config;
+  SimResult_t *results;
+  long *next_game;
+} SimWorker_t;
+
+int parse_args(int argc, char **argv, SimConfig_t *config);
+void run_batch(const SimConfig_t *config, SimResult_t *results);
+void *sim_worker(void *arg);
+SimResult_t play_game(const SimConfig_t *config, long index);
+UserAction_t next_action(const SimConfig_t *config, Game_t *game, Rng_t *rng,
+                         long tick);
+UserAction_t script_action(char c);
+void print_report(const SimConfig_t *config, SimResult_t *results,
+                  double seconds);
+void print_usage(const char *name);
+int compare_results(const void *a, const void *b);
+int compare_ticks(const void *a, const void *b);
+double now_seconds();
+
+#endif
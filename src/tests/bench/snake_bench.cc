@@ -0,0 +1,176 @@
+#include "snake_bench.h"
+
+/**
+ * @brief Started game
+ *
+ * Starts a game on the given instance: allocates memory in PAUSE,
+ * initializes stats in START and spawns the first apple.
+ *
+ * @param game Game instance
+ */
+static void started_game(Game *game) {
+  game->prms.seed = 1;
+  game->model.setSignal(Start);
+  game->model.fsm();
+  game->model.fsm();
+  game->model.setSignal(Up);
+}
+
+/**
+ * @brief Shifting
+ *
+ * shifting() of a snake running in circles: it turns right every few
+ * steps and never reaches the apple, which is taken off the field.
+ */
+static void BM_Shifting(benchmark::State &state) {
+  const int side = 4;
+  Game game;
+  int steps = 0;
+
+  started_game(&game);
+  game.prms.apple.x = -1;
+  game.prms.apple.y = -1;
+
+  for (auto _ : state) {
+    if (++steps == side) {
+      game.model.turnRight();
+      steps = 0;
+    }
+    game.model.shifting();
+    benchmark::DoNotOptimize(game.prms.state);
+  }
+
+  game.model.freeMem();
+}
+BENCHMARK(BM_Shifting);
+
+/**
+ * @brief Find empty space
+ *
+ * findEmptySpace() with the given percent of the field taken
+ * by the snake.
+ */
+static void BM_FindEmptySpace(benchmark::State &state) {
+  const int cells = FIELD_HEIGHT * FIELD_WIDTH;
+  const int free = cells - cells * (int)state.range(0) / 100;
+  Game game;
+
+  started_game(&game);
+  for (int i = 0; i < cells && game.prms.free_cells.size() > free; i++) {
+    int x = i % FIELD_WIDTH;
+    int y = i / FIELD_WIDTH;
+    if (game.prms.stats.field[y][x] != 1) game.model.occupy(x, y);
+  }
+
+  for (auto _ : state) {
+    game.model.findEmptySpace();
+    benchmark::DoNotOptimize(game.prms.apple);
+  }
+
+  game.model.freeMem();
+}
+BENCHMARK(BM_FindEmptySpace)->Arg(0)->Arg(50)->Arg(90)->Arg(99);
+
+/**
+ * @brief Autopilot game
+ *
+ * A whole game played by the autopilot through the public API until
+ * the field is full, one game per iteration. The high score is only
+ * kept in memory.
+ */
+static void BM_AutopilotGame(benchmark::State &state) {
+  uint64_t seed = 1;
+
+  highScoreSetPath(NULL);
+  for (auto _ : state) {
+    Game_t *game = gameCreate(seed++);
+    int64_t now = 0;
+
+    do {
+      now += 10;
+      gameInputAt(game, gameAutoplay(game), false, now);
+      gameStepAt(game, now);
+    } while (game->prms.stats.pause != GAMEWON &&
+             game->prms.stats.pause != GAMELOST);
+    benchmark::DoNotOptimize(game->prms.stats.score);
+    gameDestroy(game);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AutopilotGame)->Unit(benchmark::kMillisecond);
+
+/**
+ * @brief Print all
+ *
+ * printAll() of a game in progress into an ncurses screen writing
+ * to /dev/null. With a non-zero argument a next figure is drawn too,
+ * as in tetris.
+ */
+static void BM_PrintAll(benchmark::State &state) {
+  OffscreenTerm term;
+  Game game;
+  int *next_rows[BRICK_SIDE];
+  int next_cells[BRICK_SIDE][BRICK_SIDE] = {{0, 1, 1, 0}, {0, 1, 1, 0}};
+
+  if (!term.ok()) {
+    state.SkipWithError("can't create an ncurses screen");
+    return;
+  }
+
+  started_game(&game);
+  GameInfo_t stats = gameSnapshot(&game);
+  if (state.range(0)) {
+    for (int i = 0; i < BRICK_SIDE; i++) next_rows[i] = next_cells[i];
+    stats.next = next_rows;
+  }
+
+  for (auto _ : state) {
+    printAll(&stats);
+  }
+
+  game.model.freeMem();
+}
+BENCHMARK(BM_PrintAll)->Arg(0)->Arg(1);
+
+/**
+ * @brief Print frame
+ *
+ * print_frame() of a moving snake: two frames which differ in a few
+ * cells are drawn one after another over each other.
+ */
+static void BM_PrintFrame(benchmark::State &state) {
+  OffscreenTerm term;
+  Game game;
+  Frame_t frame;
+
+  if (!term.ok()) {
+    state.SkipWithError("can't create an ncurses screen");
+    return;
+  }
+
+  started_game(&game);
+  memset(&frame, 0, sizeof(frame));
+  GameInfo_t first = gameSnapshot(&game);
+  print_frame(&frame, &first, FRAME_ALL);
+
+  int cells[FIELD_HEIGHT][FIELD_WIDTH];
+  int *rows[FIELD_HEIGHT];
+  game.model.shifting();
+  GameInfo_t second = gameSnapshot(&game);
+  for (int i = 0; i < FIELD_HEIGHT; i++) {
+    std::copy_n(second.field[i], FIELD_WIDTH, cells[i]);
+    rows[i] = cells[i];
+  }
+  second.field = rows;
+  game.model.turnLeft();
+  game.model.shifting();
+
+  for (auto _ : state) {
+    print_frame(&frame, &second, FRAME_BOARD);
+    print_frame(&frame, &first, FRAME_BOARD);
+  }
+
+  game.model.freeMem();
+}
+BENCHMARK(BM_PrintFrame);
@@ -0,0 +1,50 @@
+#ifndef SNAKE_BENCH_H
+#define SNAKE_BENCH_H
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+
+#include "../../brick_game/snake/snake_model.h"
+#include "../../gui/cli/cli_view.h"
+
+/**
+ * @brief Offscreen terminal
+ *
+ * An ncurses screen writing to /dev/null, so the view can be drawn
+ * without a terminal. The screen is current while the object lives.
+ */
+class OffscreenTerm {
+ public:
+  OffscreenTerm() {
+    out_ = fopen("/dev/null", "w");
+    in_ = fopen("/dev/null", "r");
+    if (out_ && in_) screen_ = newterm("xterm", out_, in_);
+  }
+
+  ~OffscreenTerm() {
+    if (screen_) {
+      endwin();
+      delscreen(screen_);
+    }
+    if (out_) fclose(out_);
+    if (in_) fclose(in_);
+  }
+
+  OffscreenTerm(const OffscreenTerm &) = delete;
+  OffscreenTerm &operator=(const OffscreenTerm &) = delete;
+
+  /**
+   * @brief Ok
+   *
+   * @return True if the screen was created
+   */
+  bool ok() const { return screen_ != nullptr; }
+
+ private:
+  FILE *out_{};
+  FILE *in_{};
+  SCREEN *screen_{};
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "tetris_bench.h"
+
+/**
+ * @brief Started game
+ *
+ * Starts a game on the given params the way the default game does:
+ * allocates memory in PAUSE, initializes stats in START and spawns
+ * the first brick.
+ *
+ * @param prms Params structure
+ */
+static void started_game(Params_t *prms) {
+  memset(prms, 0, sizeof(*prms));
+  prms->seed = 1;
+  prms->state = PAUSE;
+  prms->signal = Start;
+  fsm(prms);
+  fsm(prms);
+  prms->signal = Up;
+}
+
+/**
+ * @brief Fill board
+ *
+ * Fills the bottom rows of the board with a fixed pattern, leaving
+ * one hole per row, so that no row is complete.
+ *
+ * @param prms Params structure
+ * @param rows Number of rows to fill
+ */
+static void fill_board(Params_t *prms, int rows) {
+  for (int i = 0; i < rows; i++) {
+    prms->board[FIELD_HEIGHT - 1 - i] =
+        FIELD_ROW_FULL & ~(uint16_t)(1u << ((i * 7) % FIELD_WIDTH));
+  }
+  prms->field_dirty = 1;
+}
+
+/**
+ * @brief FSM step
+ *
+ * One fsm() call from every state the game passes during play.
+ * Params are restored from a prepared copy before each step, the copy
+ * is part of the measured time.
+ */
+static void BM_FsmStep(benchmark::State &state) {
+  Params_t base;
+  GameState_t game_state = (GameState_t)state.range(0);
+
+  started_game(&base);
+  fill_board(&base, FIELD_HEIGHT / 2);
+  base.state = MOVING;
+  fsm(&base);
+  if (game_state == ATTACHING) {
+    clear_brick(&base);
+    movedown(&base);
+  }
+  base.state = game_state;
+  if (game_state == START) base.signal = Start;
+
+  for (auto _ : state) {
+    Params_t prms = base;
+    fsm(&prms);
+    benchmark::DoNotOptimize(prms);
+  }
+
+  state.SetLabel(kStateNames[game_state]);
+  mem_free(&base.stats);
+}
+BENCHMARK(BM_FsmStep)
+    ->Arg(START)
+    ->Arg(SPAWN)
+    ->Arg(MOVING)
+    ->Arg(SHIFTING)
+    ->Arg(ATTACHING)
+    ->Arg(PAUSE);
+
+/**
+ * @brief Check collision
+ *
+ * check_collision() for every piece and rotation in every column
+ * above a half filled board.
+ */
+static void BM_CheckCollision(benchmark::State &state) {
+  Params_t prms;
+
+  started_game(&prms);
+  clear_brick(&prms);
+  fill_board(&prms, FIELD_HEIGHT / 2);
+  prms.brick.y = FIELD_HEIGHT / 2 - BRICK_SIDE;
+
+  for (auto _ : state) {
+    int collisions = 0;
+    for (int piece = 0; piece < BRICK_PIECES; piece++) {
+      prms.brick.piece = (BrickPiece_t)piece;
+      for (int rotation = 0; rotation < BRICK_ROTATIONS; rotation++) {
+        prms.brick.rotation = rotation;
+        for (int x = -2; x < FIELD_WIDTH; x++) {
+          prms.brick.x = x;
+          collisions += check_collision(&prms);
+        }
+      }
+    }
+    benchmark::DoNotOptimize(collisions);
+  }
+
+  state.SetItemsProcessed(state.iterations() * BRICK_PIECES *
+                          BRICK_ROTATIONS * (FIELD_WIDTH + 2));
+  mem_free(&prms.stats);
+}
+BENCHMARK(BM_CheckCollision);
+
+/**
+ * @brief Remove line
+ *
+ * remove_line() on a half filled board with 1 to 4 complete lines
+ * at the bottom.
+ */
+static void BM_RemoveLine(benchmark::State &state) {
+  Params_t base;
+  int lines = (int)state.range(0);
+
+  started_game(&base);
+  clear_brick(&base);
+  fill_board(&base, FIELD_HEIGHT / 2);
+  for (int i = 0; i < lines; i++) {
+    base.board[FIELD_HEIGHT - 1 - i * 2] = FIELD_ROW_FULL;
+  }
+
+  for (auto _ : state) {
+    Params_t prms = base;
+    benchmark::DoNotOptimize(remove_line(&prms));
+    benchmark::DoNotOptimize(prms);
+  }
+
+  mem_free(&base.stats);
+}
+BENCHMARK(BM_RemoveLine)->DenseRange(1, 4);
+
+/**
+ * @brief Move down
+ *
+ * Hard drop of the spawned brick onto a board with the given number
+ * of filled rows.
+ */
+static void BM_MoveDown(benchmark::State &state) {
+  Params_t prms;
+
+  started_game(&prms);
+  clear_brick(&prms);
+  fill_board(&prms, (int)state.range(0));
+
+  for (auto _ : state) {
+    prms.brick.y = BRICKSTART_Y;
+    movedown(&prms);
+    benchmark::DoNotOptimize(prms.brick);
+  }
+
+  mem_free(&prms.stats);
+}
+BENCHMARK(BM_MoveDown)->Arg(0)->Arg(FIELD_HEIGHT / 2)->Arg(FIELD_HEIGHT - 4);
+
+/**
+ * @brief Bot best move
+ *
+ * Enumeration and evaluation of every reachable placement of each piece
+ * above a board with the given number of filled rows, one decision of
+ * the bot per piece.
+ */
+static void BM_BotBestMove(benchmark::State &state) {
+  Params_t prms;
+
+  started_game(&prms);
+  clear_brick(&prms);
+  fill_board(&prms, (int)state.range(0));
+
+  for (auto _ : state) {
+    for (int piece = 0; piece < BRICK_PIECES; piece++) {
+      BotMove_t best;
+      spawn_brick(&prms);
+      prms.brick.piece = (BrickPiece_t)piece;
+      benchmark::DoNotOptimize(
+          bot_best_move(&prms, &bot_default_weights, &best));
+      benchmark::DoNotOptimize(best);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * BRICK_PIECES);
+  mem_free(&prms.stats);
+}
+BENCHMARK(BM_BotBestMove)->Arg(0)->Arg(FIELD_HEIGHT / 2);
+
+/**
+ * @brief Plan best move
+ *
+ * One lookahead search of the planner per piece above a half filled
+ * board, for the given beam width and number of threads. The cache and
+ * the last plan are reset before every search, outside the measured time.
+ */
+static void BM_PlanBestMove(benchmark::State &state) {
+  Params_t prms;
+  PlanConfig_t config = {(int)state.range(0), (int)state.range(1), 0, 0};
+  Planner_t *planner = plan_create(&config, &bot_default_weights);
+
+  started_game(&prms);
+  clear_brick(&prms);
+  fill_board(&prms, FIELD_HEIGHT / 2);
+
+  for (auto _ : state) {
+    for (int piece = 0; piece < BRICK_PIECES; piece++) {
+      BotMove_t best;
+      state.PauseTiming();
+      memset(planner->cache, 0, PLAN_CACHE_SIZE * sizeof(PlanEntry_t));
+      planner->figure = 0;
+      spawn_brick(&prms);
+      prms.brick.piece = (BrickPiece_t)piece;
+      state.ResumeTiming();
+      benchmark::DoNotOptimize(plan_best_move(planner, &prms, &best));
+      benchmark::DoNotOptimize(best);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * BRICK_PIECES);
+  plan_destroy(planner);
+  mem_free(&prms.stats);
+}
+BENCHMARK(BM_PlanBestMove)
+    ->ArgNames({"beam", "threads"})
+    ->Args({4, 1})
+    ->Args({8, 1})
+    ->Args({8, 4})
+    ->UseRealTime();
@@ -0,0 +1,20 @@
+#ifndef TETRIS_BENCH_H
+#define TETRIS_BENCH_H
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include "../../brick_game/tetris/tetris_planner.h"
+}
+
+/**
+ * @brief State names
+ *
+ * Names of the game states, indexed by GameState_t, used as benchmark
+ * labels.
+ */
+static const char *const kStateNames[] = {
+    "START", "SPAWN",    "MOVING",      "SHIFTING",  "ATTACHING",
+    "PAUSE", "GAMEOVER", "GAMEOVERWON", "EXIT_STATE"};
+
+#endif
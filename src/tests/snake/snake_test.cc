@@ -164,6 +164,314 @@ TEST(test_snake, EXIT_STATE) {
   EXPECT_EQ(GAMEEXIT, prms.stats.pause);
 }
 
+TEST(test_snake, Instances) {
+  Game_t* first = gameCreate(1);
+  Game_t* second = gameCreate(2);
+  ASSERT_NE(nullptr, first);
+  ASSERT_NE(nullptr, second);
+
+  gameInput(first, Start, false);
+  gameStep(first);
+  gameStep(first);
+  gameStep(second);
+  EXPECT_EQ(PLAYING, gameSnapshot(first).pause);
+  EXPECT_EQ(STARTING, gameSnapshot(second).pause);
+  EXPECT_EQ(1, gameSnapshot(first).field[9][5]);
+  EXPECT_EQ(0, gameSnapshot(second).field[9][5]);
+
+  gameInput(first, Terminate, false);
+  gameStep(first);
+  gameStep(first);
+  EXPECT_EQ(GAMEEXIT, gameSnapshot(first).pause);
+  gameDestroy(first);
+  gameDestroy(second);
+}
+
+TEST(test_snake, ContiguousField) {
+  s21::SnakeBody body{};
+  s21::Params_t prms{body};
+  s21::SnakeModel Snake{prms};
+
+  Snake.memAlloc();
+  for (int i = 0; i < FIELD_HEIGHT; ++i) {
+    EXPECT_EQ(prms.stats.field[0] + i * FIELD_WIDTH, prms.stats.field[i]);
+  }
+  prms.stats.field[FIELD_HEIGHT - 1][FIELD_WIDTH - 1] = 1;
+  Snake.clearField();
+  EXPECT_EQ(0, prms.stats.field[FIELD_HEIGHT - 1][FIELD_WIDTH - 1]);
+  Snake.freeMem();
+  EXPECT_EQ(nullptr, prms.stats.field);
+}
+
+TEST(test_snake, RingBody) {
+  s21::SnakeBody body{};
+
+  body.push(0, 0);
+  for (int i = 1; i < 3 * s21::SnakeBody::kCapacity; ++i) {
+    body.push(i % FIELD_WIDTH, (i / FIELD_WIDTH) % FIELD_HEIGHT);
+    body.pop();
+  }
+  int last = 3 * s21::SnakeBody::kCapacity - 1;
+  EXPECT_EQ(1, body.getSize());
+  EXPECT_EQ(last % FIELD_WIDTH, body.getHead().x);
+  EXPECT_EQ((last / FIELD_WIDTH) % FIELD_HEIGHT, body.getTail().y);
+
+  body.pushBack(FIELD_WIDTH - 1, FIELD_HEIGHT - 1);
+  EXPECT_EQ(2, body.getSize());
+  EXPECT_EQ(FIELD_WIDTH - 1, body.getTail().x);
+  EXPECT_EQ(FIELD_HEIGHT - 1, body.getTail().y);
+  EXPECT_EQ(last % FIELD_WIDTH, body.getHead().x);
+}
+
+TEST(test_snake, FreeCells) {
+  s21::SnakeBody body{};
+  s21::Params_t prms{body};
+  s21::SnakeModel Snake{prms};
+
+  Snake.setSignal(Start);
+  Snake.pause();
+  EXPECT_EQ(FIELD_WIDTH * FIELD_HEIGHT - 4, prms.free_cells.size());
+
+  for (int i = 0; i < FIELD_HEIGHT; ++i) {
+    for (int j = 0; j < FIELD_WIDTH; ++j) {
+      if (prms.stats.field[i][j] != 1 && !(i == 7 && j == 3)) {
+        Snake.occupy(j, i);
+      }
+    }
+  }
+  EXPECT_EQ(1, prms.free_cells.size());
+  Snake.findEmptySpace();
+  EXPECT_EQ(3, prms.apple.x);
+  EXPECT_EQ(7, prms.apple.y);
+  EXPECT_EQ(2, prms.stats.field[7][3]);
+
+  Snake.occupy(3, 7);
+  Snake.findEmptySpace();
+  EXPECT_EQ(-1, prms.apple.x);
+  Snake.vacate(0, 0);
+  Snake.vacate(9, 19);
+  EXPECT_EQ(2, prms.free_cells.size());
+  int packed = prms.free_cells.at(0) + prms.free_cells.at(1);
+  EXPECT_EQ(19 * FIELD_WIDTH + 9, packed);
+  prms.state = EXIT_STATE;
+  Snake.fsm();
+}
+
+TEST(test_snake, Seed) {
+  Game_t* first = gameCreate(42);
+  Game_t* second = gameCreate(42);
+
+  gameInput(first, Start, false);
+  gameInput(second, Start, false);
+  for (int i = 0; i < 200; ++i) {
+    gameStep(first);
+    gameStep(second);
+    EXPECT_EQ(first->prms.apple.x, second->prms.apple.x);
+    EXPECT_EQ(first->prms.apple.y, second->prms.apple.y);
+    UserAction_t action = i % 3 ? Action : (i % 2 ? Left : Right);
+    gameInput(first, action, false);
+    gameInput(second, action, false);
+  }
+  EXPECT_EQ(0, memcmp(gameSnapshot(first).field[0],
+                      gameSnapshot(second).field[0],
+                      FIELD_WIDTH * FIELD_HEIGHT * sizeof(int)));
+  gameDestroy(first);
+  gameDestroy(second);
+}
+
+TEST(test_snake, Deadline) {
+  const int interval = INITIAL_TIMEOUT / 2;
+  Game_t* game = gameCreate(1);
+
+  EXPECT_EQ(NO_DEADLINE, gameDeadline(game));
+  gameInput(game, Start, false);
+  gameStepAt(game, 1000);
+  gameStepAt(game, 1000);
+  EXPECT_EQ(MOVING, game->prms.state);
+  EXPECT_EQ(1000 + interval, gameDeadline(game));
+
+  gameStepAt(game, 999 + interval);
+  EXPECT_EQ(MOVING, game->prms.state);
+  gameStepAt(game, 1000 + interval);
+  EXPECT_EQ(SHIFTING, game->prms.state);
+  EXPECT_EQ(1000 + interval, gameDeadline(game));
+  EXPECT_EQ(1000 + 2 * interval, game->prms.step_at);
+
+  gameStepAt(game, 1000 + interval);
+  gameInput(game, Action, false);
+  gameStepAt(game, 1100 + interval);
+  EXPECT_EQ(SHIFTING, game->prms.state);
+  EXPECT_EQ(1100 + 2 * interval, game->prms.step_at);
+  gameDestroy(game);
+}
+
+TEST(test_snake, InputQueue) {
+  Game_t* game = gameCreate(1);
+
+  gameInput(game, Start, false);
+  gameStepAt(game, 1000);
+  gameStepAt(game, 1000);
+  s21::LookDirection_t direction = game->prms.direction;
+  gameInput(game, Right, false);
+  gameInput(game, Right, false);
+  EXPECT_EQ(1000, gameDeadline(game));
+  gameStepAt(game, 1000);
+  EXPECT_EQ((direction + 2) % 4, game->prms.direction);
+
+  for (int i = 0; i < INPUT_QUEUE_SIZE + 3; i++) gameInput(game, Left, false);
+  EXPECT_EQ(3u, gameDroppedInputs(game));
+  gameDestroy(game);
+}
+
+TEST(test_snake, Repeat) {
+  const int interval = INITIAL_TIMEOUT / 2;
+  Game_t* game = gameCreate(1);
+
+  gameSetRepeat(game, 100, 50);
+  gameInput(game, Start, false);
+  gameStepAt(game, 1000);
+  gameStepAt(game, 1000);
+  gameInputAt(game, Action, true, 1000);
+  gameStepAt(game, 1000);
+  EXPECT_EQ(SHIFTING, game->prms.state);
+  gameStepAt(game, 1000);
+  EXPECT_EQ(MOVING, game->prms.state);
+  EXPECT_EQ(1100, gameDeadline(game));
+
+  gameStepAt(game, 1100);
+  EXPECT_EQ(SHIFTING, game->prms.state);
+  EXPECT_EQ(1100 + interval, game->prms.step_at);
+  gameStepAt(game, 1100);
+
+  gameInputAt(game, Action, false, 1120);
+  gameStepAt(game, 1160);
+  EXPECT_EQ(MOVING, game->prms.state);
+  EXPECT_EQ(1100 + interval, gameDeadline(game));
+  gameDestroy(game);
+}
+
+TEST(test_snake, FrameVersion) {
+  Game_t* game = gameCreate(1);
+
+  gameInput(game, Start, false);
+  gameStepAt(game, 1000);
+  gameStepAt(game, 1000);
+  GameFrame_t frame = gameFrame(game, 0);
+  EXPECT_EQ(&game->prms.stats, frame.stats);
+  EXPECT_EQ(static_cast<uint32_t>(FRAME_ALL), frame.changed);
+
+  uint64_t seen = frame.version;
+  gameStepAt(game, 1100);
+  gameInput(game, Left, false);
+  gameStepAt(game, 1200);
+  frame = gameFrame(game, seen);
+  EXPECT_EQ(seen, frame.version);
+  EXPECT_EQ(0u, frame.changed);
+
+  gameStepAt(game, 1000 + INITIAL_TIMEOUT / 2);
+  gameStepAt(game, 1000 + INITIAL_TIMEOUT / 2);
+  frame = gameFrame(game, seen);
+  EXPECT_EQ(seen + 1, frame.version);
+  EXPECT_EQ(static_cast<uint32_t>(FRAME_BOARD), frame.changed);
+  gameDestroy(game);
+}
+
+TEST(test_snake, Autopilot) {
+  highScoreSetPath(NULL);
+  Game_t* game = gameCreate(3);
+  int64_t now = 1000;
+
+  gameInputAt(game, gameAutoplay(game), false, now);
+  gameStepAt(game, now);
+  while (game->prms.stats.pause == PLAYING && now < 10000000) {
+    now += 10;
+    gameInputAt(game, gameAutoplay(game), false, now);
+    gameStepAt(game, now);
+  }
+  EXPECT_EQ(GAMEWON, game->prms.stats.pause);
+  EXPECT_EQ(0, game->prms.free_cells.size());
+  EXPECT_EQ(FIELD_WIDTH * FIELD_HEIGHT, game->prms.body->getSize());
+  gameDestroy(game);
+}
+
+TEST(test_snake, Hash) {
+  highScoreSetPath(NULL);
+  Game_t* game = gameCreate(3);
+  int64_t now = 1000;
+  int changes = 0;
+
+  EXPECT_EQ(0u, gameHash(game));
+  for (int i = 0; i < 3000; i++) {
+    uint64_t hash = gameHash(game);
+    UserAction_t action = game->prms.stats.pause == PLAYING
+                              ? (i % 40 ? Up : Left)
+                              : Start;
+
+    now += 10;
+    gameInputAt(game, action, false, now);
+    gameStepAt(game, now);
+    changes += gameHash(game) != hash;
+    ASSERT_EQ(game->model.hashState(), gameHash(game));
+  }
+  EXPECT_LT(50, changes);
+  gameDestroy(game);
+}
+
+TEST(test_snake, LeaderboardProcesses) {
+  char path[] = "/tmp/s21_leaderboard_XXXXXX";
+  LeaderEntry_t entries[LEADERBOARD_SIZE];
+  Leaderboard_t board;
+  pid_t children[2];
+  int start[2];
+  char go;
+  int fd = mkstemp(path);
+
+  ASSERT_NE(-1, fd);
+  close(fd);
+  ASSERT_EQ(0, pipe(start));
+  for (int i = 0; i < 2; i++) {
+    children[i] = fork();
+    ASSERT_NE(-1, children[i]);
+    if (children[i] == 0) {
+      close(start[1]);
+      int opened = read(start[0], &go, 1) == 0 &&
+                   leaderboardOpen(&board, path) == 0;
+
+      for (int j = 0; opened && j < 2000; j++) {
+        LeaderEntry_t entry = {};
+        entry.score = 2 * j + i;
+        entry.seed = i;
+        leaderboardInsert(&board, &entry);
+      }
+      leaderboardClose(&board);
+      _exit(opened ? 0 : 1);
+    }
+  }
+
+  close(start[0]);
+  close(start[1]);
+  ASSERT_EQ(0, leaderboardOpen(&board, path));
+  for (int i = 0; i < 2; i++) {
+    int status = 0;
+
+    while (waitpid(children[i], &status, WNOHANG) == 0) {
+      int count = leaderboardRead(&board, entries);
+
+      ASSERT_LE(count, LEADERBOARD_SIZE);
+      for (int j = 1; j < count; j++)
+        ASSERT_GE(entries[j - 1].score, entries[j].score);
+    }
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+  ASSERT_EQ(LEADERBOARD_SIZE, leaderboardRead(&board, entries));
+  for (int j = 0; j < LEADERBOARD_SIZE; j++) {
+    EXPECT_EQ(3999 - j, entries[j].score);
+    EXPECT_EQ(static_cast<uint64_t>((3999 - j) % 2), entries[j].seed);
+  }
+  leaderboardClose(&board);
+  remove(path);
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -2,6 +2,8 @@
 #define SNAKE_TEST_H
 
 #include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "../../brick_game/snake/snake_model.h"
 // #include "../../gui/cli/cli_controller.h"
@@ -68,7 +68,7 @@ START_TEST(test5) {
   Params_t prms = {.state = PAUSE};
   prms.signal = Start;
   pause(&prms);
-  for (int j = 0; j < 10; j++) prms.stats.field[0][j] = 1;
+  prms.board[0] = FIELD_ROW_FULL;
   ck_assert_int_eq(1, check_game_over(&prms));
   mem_free(&prms.stats);
 }
@@ -140,7 +140,7 @@ START_TEST(test11) {
   fsm(&prms);
   prms.signal = Up;
   userInput(prms.signal, false);
-  prms.ticks = 300000;
+  prms.now = prms.step_at;
   fsm(&prms);
   ck_assert_int_eq(SHIFTING, prms.state);
   mem_free(&prms.stats);
@@ -190,7 +190,7 @@ START_TEST(test16) {
   Params_t prms = {.state = PAUSE};
   prms.signal = Start;
   pause(&prms);
-  for (int j = 0; j < 10; j++) prms.stats.field[19][j] = 1;
+  prms.board[19] = FIELD_ROW_FULL;
   remove_line(&prms);
   ck_assert_int_eq(100, prms.stats.score);
   mem_free(&prms.stats);
@@ -299,6 +299,466 @@ START_TEST(test24) {
   mem_free(&prms.stats);
 }
 
+START_TEST(test25) {
+  Game_t* first = gameCreate(1);
+  Game_t* second = gameCreate(2);
+  ck_assert_ptr_nonnull(first);
+  ck_assert_ptr_nonnull(second);
+
+  gameInput(first, Start, false);
+  gameStep(first);
+  gameStep(first);
+  gameStep(second);
+  ck_assert_int_eq(PLAYING, gameSnapshot(first).pause);
+  ck_assert_int_eq(STARTING, gameSnapshot(second).pause);
+  ck_assert_ptr_ne(gameSnapshot(first).field, gameSnapshot(second).field);
+
+  gameInput(first, Terminate, false);
+  gameStep(first);
+  gameStep(first);
+  ck_assert_int_eq(GAMEEXIT, gameSnapshot(first).pause);
+  ck_assert_ptr_null(gameSnapshot(first).field);
+  gameDestroy(first);
+  gameDestroy(second);
+}
+
+START_TEST(test26) {
+  Params_t prms = {.state = PAUSE};
+  prms.signal = Start;
+  pause(&prms);
+  spawn_brick(&prms);
+  prms.board[5] = FIELD_ROW_FULL;
+  prms.brick.y = 2;
+  ck_assert_int_eq(0, check_collision(&prms));
+  prms.brick.y = 4;
+  ck_assert_int_eq(1, check_collision(&prms));
+  prms.brick.y = 2;
+  prms.brick.x = FIELD_WIDTH - 1;
+  ck_assert_int_eq(1, check_collision(&prms));
+  prms.board[5] = 1;
+
+  prms.brick.x = BRICKSTART_X;
+  place_brick(&prms);
+  GameInfo_t stats = gameSnapshot(&prms);
+  for (int i = 0; i < FIELD_HEIGHT; i++) {
+    for (int j = 0; j < FIELD_WIDTH; j++) {
+      ck_assert_int_eq(prms.board[i] >> j & 1, stats.field[i][j]);
+    }
+  }
+  ck_assert_int_eq(1, stats.field[5][0]);
+  clear_brick(&prms);
+  ck_assert_int_eq(1, prms.board[5]);
+  mem_free(&prms.stats);
+}
+
+START_TEST(test27) {
+  Params_t prms = {.state = PAUSE};
+  prms.brick.piece = I_PIECE;
+  rotate_brick(&prms);
+  for (int i = 0; i < BRICK_SIDE; i++) {
+    ck_assert_int_eq(0x4, brick_rows(&prms)[i]);
+  }
+  rotate_backwards(&prms);
+  rotate_backwards(&prms);
+  ck_assert_int_eq(3, prms.brick.rotation);
+  for (int i = 0; i < 3; i++) rotate_brick(&prms);
+  ck_assert_int_eq(2, prms.brick.rotation);
+  ck_assert_int_eq(0xF, brick_rows(&prms)[2]);
+
+  for (int id = 0; id < BRICK_PIECES; id++) {
+    for (int r = 0; r < BRICK_ROTATIONS; r++) {
+      int cells = 0;
+      for (int i = 0; i < BRICK_SIDE; i++) {
+        cells += __builtin_popcount(brick_shapes[id][r][i]);
+      }
+      ck_assert_int_eq(4, cells);
+    }
+  }
+}
+
+START_TEST(test28) {
+  Params_t prms = {.state = PAUSE};
+  prms.signal = Start;
+  pause(&prms);
+  prms.board[19] = FIELD_ROW_FULL;
+  prms.board[18] = FIELD_ROW_FULL;
+  prms.board[17] = 0x1;
+  prms.board[16] = FIELD_ROW_FULL;
+  prms.board[15] = 0x2;
+  prms.board[13] = 0x4;
+  uint32_t cleared = remove_line(&prms);
+  ck_assert_uint_eq((1u << 19) | (1u << 18) | (1u << 16), cleared);
+  ck_assert_uint_eq(cleared, prms.cleared_rows);
+  ck_assert_int_eq(0x1, prms.board[19]);
+  ck_assert_int_eq(0x2, prms.board[18]);
+  ck_assert_int_eq(0x0, prms.board[17]);
+  ck_assert_int_eq(0x4, prms.board[16]);
+  for (int i = 0; i < 16; i++) ck_assert_int_eq(0, prms.board[i]);
+  ck_assert_int_eq(700, prms.stats.score);
+
+  ck_assert_uint_eq(0, remove_line(&prms));
+  ck_assert_int_eq(0x1, prms.board[19]);
+  mem_free(&prms.stats);
+}
+
+START_TEST(test29) {
+  Params_t prms = {.state = PAUSE};
+  ck_assert_int_eq(0, mem_alloc(&prms));
+  for (int i = 0; i < FIELD_HEIGHT; i++) {
+    ck_assert_ptr_eq(prms.stats.field[0] + i * FIELD_WIDTH,
+                     prms.stats.field[i]);
+  }
+  for (int i = 0; i < BRICK_SIDE; i++) {
+    ck_assert_ptr_eq(prms.stats.next[0] + i * BRICK_SIDE, prms.stats.next[i]);
+  }
+  mem_free(&prms.stats);
+  ck_assert_ptr_null(prms.stats.field);
+}
+
+START_TEST(test30) {
+  Game_t* first = gameCreate(42);
+  Game_t* second = gameCreate(42);
+  UserAction_t script[] = {Start, Up, Left, Action, Down, Up, Right, Down};
+
+  for (int i = 0; i < 400; i++) {
+    UserAction_t action = script[i % 8];
+    if (action == Start && gameSnapshot(first).pause != GAMELOST && i > 0)
+      action = Up;
+    gameInput(first, action, false);
+    gameInput(second, action, false);
+    gameStep(first);
+    gameStep(second);
+    ck_assert_int_eq(first->brick.piece, second->brick.piece);
+    ck_assert_int_eq(first->brick.next_brick, second->brick.next_brick);
+    ck_assert_mem_eq(first->board, second->board, sizeof(first->board));
+  }
+  ck_assert_int_eq(gameSnapshot(first).score, gameSnapshot(second).score);
+  gameDestroy(first);
+  gameDestroy(second);
+}
+
+START_TEST(test31) {
+  Game_t* game = gameCreate(1);
+
+  ck_assert_int_eq(NO_DEADLINE, gameDeadline(game));
+  gameInput(game, Start, false);
+  gameStepAt(game, 1000);
+  gameStepAt(game, 1000);
+  ck_assert_int_eq(MOVING, game->state);
+  ck_assert_int_eq(1000 + INITIAL_TIMEOUT, gameDeadline(game));
+
+  gameStepAt(game, 999 + INITIAL_TIMEOUT);
+  ck_assert_int_eq(MOVING, game->state);
+  gameStepAt(game, 1000 + INITIAL_TIMEOUT);
+  ck_assert_int_eq(SHIFTING, game->state);
+  ck_assert_int_eq(1000 + INITIAL_TIMEOUT, gameDeadline(game));
+  ck_assert_int_eq(1000 + 2 * INITIAL_TIMEOUT, game->step_at);
+
+  gameStepAt(game, 1000 + INITIAL_TIMEOUT);
+  gameStepAt(game, 1000 + 5 * INITIAL_TIMEOUT);
+  ck_assert_int_eq(SHIFTING, game->state);
+  ck_assert_int_eq(1000 + 5 * INITIAL_TIMEOUT, game->step_at);
+  gameDestroy(game);
+}
+
+START_TEST(test32) {
+  Game_t* game = gameCreate(1);
+
+  gameInput(game, Start, false);
+  gameStepAt(game, 1000);
+  gameStepAt(game, 1000);
+  gameInput(game, Left, false);
+  gameInput(game, Left, false);
+  ck_assert_int_eq(1000, gameDeadline(game));
+  gameStepAt(game, 1000);
+  ck_assert_int_eq(BRICKSTART_X - 2, game->brick.x);
+
+  gameInput(game, Down, false);
+  gameInput(game, Left, false);
+  gameStepAt(game, 1000);
+  ck_assert_int_eq(MOVING, game->state);
+  ck_assert_int_eq(BRICKSTART_X - 1, game->brick.x);
+
+  for (int i = 0; i < INPUT_QUEUE_SIZE + 6; i++) gameInput(game, Right, false);
+  ck_assert_int_eq(6, gameDroppedInputs(game));
+  gameDestroy(game);
+}
+
+START_TEST(test33) {
+  Game_t* game = gameCreate(1);
+
+  gameSetRepeat(game, 100, 20);
+  gameInput(game, Start, false);
+  gameStepAt(game, 1000);
+  gameStepAt(game, 1000);
+  gameInputAt(game, Left, true, 1000);
+  gameStepAt(game, 1000);
+  ck_assert_int_eq(BRICKSTART_X - 1, game->brick.x);
+
+  gameInputAt(game, Left, true, 1050);
+  gameStepAt(game, 1050);
+  ck_assert_int_eq(BRICKSTART_X - 1, game->brick.x);
+  ck_assert_int_eq(1100, gameDeadline(game));
+  gameStepAt(game, 1100);
+  ck_assert_int_eq(BRICKSTART_X - 2, game->brick.x);
+  ck_assert_int_eq(1120, gameDeadline(game));
+
+  gameInputAt(game, Left, false, 1110);
+  gameStepAt(game, 1130);
+  ck_assert_int_eq(BRICKSTART_X - 2, game->brick.x);
+  ck_assert_int_eq(1000 + INITIAL_TIMEOUT, gameDeadline(game));
+  gameInputAt(game, Left, false, 1140);
+  gameStepAt(game, 1140);
+  ck_assert_int_eq(BRICKSTART_X - 3, game->brick.x);
+  gameDestroy(game);
+}
+
+START_TEST(test34) {
+  Game_t* game = gameCreate(1);
+  GameFrame_t frame = gameFrame(game, 0);
+
+  ck_assert_int_eq(FRAME_ALL, frame.changed);
+  gameInput(game, Start, false);
+  gameStepAt(game, 1000);
+  gameStepAt(game, 1000);
+  frame = gameFrame(game, 0);
+  ck_assert_ptr_eq(&game->stats, frame.stats);
+  ck_assert_int_eq(FRAME_ALL, frame.changed);
+
+  gameStepAt(game, 1000);
+  uint64_t seen = gameFrame(game, 0).version;
+  gameStepAt(game, 1500);
+  frame = gameFrame(game, seen);
+  ck_assert_int_eq(seen, frame.version);
+  ck_assert_int_eq(0, frame.changed);
+
+  gameInput(game, Left, false);
+  gameStepAt(game, 1500);
+  frame = gameFrame(game, seen);
+  ck_assert_int_eq(seen + 1, frame.version);
+  ck_assert_int_eq(FRAME_BOARD, frame.changed);
+
+  seen = frame.version;
+  gameInput(game, Down, false);
+  for (int i = 0; i < 4; i++) gameStepAt(game, 1500);
+  frame = gameFrame(game, seen);
+  ck_assert_int_eq(FRAME_BOARD | FRAME_NEXT,
+                   frame.changed & (FRAME_BOARD | FRAME_NEXT));
+
+  seen = frame.version;
+  gameInput(game, Pause, false);
+  gameStepAt(game, 1500);
+  frame = gameFrame(game, seen);
+  ck_assert_int_eq(FRAME_PAUSE, frame.changed);
+  gameDestroy(game);
+}
+
+START_TEST(test35) {
+  char path[] = "/tmp/s21_high_score_XXXXXX";
+  int fd = mkstemp(path);
+  int score = 0;
+
+  ck_assert_int_ne(-1, fd);
+  FILE* file = fdopen(fd, "w");
+  fprintf(file, "42");
+  fclose(file);
+  highScoreSetPath(path);
+  ck_assert_int_eq(42, highScoreLoad("unused"));
+
+  highScoreSubmit(41);
+  highScoreSubmit(100);
+  highScoreFlush();
+  file = fopen(path, "r");
+  ck_assert_ptr_nonnull(file);
+  ck_assert_int_eq(1, fscanf(file, "%d", &score));
+  fclose(file);
+  ck_assert_int_eq(100, score);
+
+  highScoreSetPath(NULL);
+  remove(path);
+}
+END_TEST
+
+START_TEST(test36) {
+  char path[] = "/tmp/s21_high_score_XXXXXX";
+  char board_path[sizeof(path) + sizeof(LEADERBOARD_EXTENSION)];
+  LeaderEntry_t entries[LEADERBOARD_SIZE];
+  Leaderboard_t board, other;
+
+  fclose(fdopen(mkstemp(path), "w"));
+  leaderboardPath(board_path, sizeof(board_path), path);
+  highScoreSetPath(path);
+  highScoreLoad("unused");
+  for (int i = 0; i < 3; i++) {
+    LeaderEntry_t entry = {.score = i == 1 ? 9 : 5, .level = 1, .seed = i};
+    highScoreRecord(&entry);
+  }
+  highScoreFlush();
+  ck_assert_int_eq(3, highScoreLeaders(entries));
+  ck_assert_int_eq(9, entries[0].score);
+  ck_assert_int_eq(0, (int)entries[1].seed);
+  ck_assert_int_eq(2, (int)entries[2].seed);
+
+  ck_assert_int_eq(0, leaderboardOpen(&board, board_path));
+  ck_assert_int_eq(0, leaderboardOpen(&other, board_path));
+  for (int i = 0; i < LEADERBOARD_SIZE; i++) {
+    LeaderEntry_t entry = {.score = 6 + i};
+    leaderboardInsert(&board, &entry);
+  }
+  LeaderEntry_t low = {.score = 1};
+  ck_assert_int_eq(-1, leaderboardInsert(&board, &low));
+  ck_assert_int_eq(LEADERBOARD_SIZE, leaderboardRead(&other, entries));
+  ck_assert_int_eq(15, entries[0].score);
+  ck_assert_int_eq(9, entries[6].score);
+  ck_assert_int_eq(1, (int)entries[6].seed);
+  ck_assert_int_eq(7, entries[LEADERBOARD_SIZE - 1].score);
+  board.file->count = 1000;
+  ck_assert_int_eq(LEADERBOARD_SIZE, leaderboardRead(&other, entries));
+  LeaderEntry_t high = {.score = 100};
+  ck_assert_int_eq(0, leaderboardInsert(&board, &high));
+  ck_assert_int_eq(LEADERBOARD_SIZE, (int)other.file->count);
+  leaderboardClose(&other);
+  leaderboardClose(&board);
+
+  highScoreSetPath(NULL);
+  remove(board_path);
+  remove(path);
+}
+END_TEST
+
+START_TEST(test37) {
+  Game_t* game = gameCreate(1);
+  BotMove_t best;
+
+  gameInput(game, Start, false);
+  gameStepAt(game, 0);
+  gameStepAt(game, 0);
+  clear_brick(game);
+  game->board[FIELD_HEIGHT - 1] = FIELD_ROW_FULL & ~0x3C0;
+  game->brick.piece = I_PIECE;
+  game->brick.rotation = 0;
+  game->brick.x = BRICKSTART_X;
+  game->brick.y = BRICKSTART_Y;
+  ck_assert_int_lt(0, bot_best_move(game, &bot_default_weights, &best));
+  ck_assert_int_eq(6, best.x);
+  ck_assert_int_eq(0, best.rotation % 2);
+
+  for (int i = 0; i < 10 && game->stats.score == 0; i++) {
+    gameInput(game, gameAutoplay(game), false);
+    gameStepAt(game, 0);
+  }
+  ck_assert_int_eq(100, game->stats.score);
+  gameDestroy(game);
+}
+END_TEST
+
+START_TEST(test38) {
+  Game_t* game = gameCreate(7);
+  int64_t now = 0;
+
+  gameInput(game, gameAutoplay(game), false);
+  gameStepAt(game, now);
+  for (int i = 0; i < 20000 && game->stats.pause == PLAYING; i++) {
+    gameInputAt(game, gameAutoplay(game), false, now);
+    now += 5;
+    gameStepAt(game, now);
+  }
+  ck_assert_int_le(10, game->lines);
+  ck_assert_int_le(game->lines * 100, game->stats.score);
+  gameDestroy(game);
+}
+END_TEST
+
+START_TEST(test39) {
+  Game_t* game = gameCreate(7);
+  PlanConfig_t config = {.beam = 4, .threads = 4, .nodes = 1, .time_ms = 0};
+  BotMove_t best;
+  BotMove_t again;
+  int64_t now = 0;
+
+  gameInput(game, Start, false);
+  gameStepAt(game, 0);
+  gameStepAt(game, 0);
+  ck_assert_int_eq(0, gameSetPlanning(game, &config));
+  ck_assert_int_eq(1, plan_best_move(game->planner, game, &best));
+  ck_assert_int_le(game->planner->nodes, config.beam);
+  ck_assert_int_eq(1, plan_best_move(game->planner, game, &again));
+  ck_assert_int_eq(best.x, again.x);
+  ck_assert_int_eq(best.rotation, again.rotation);
+
+  config.nodes = 0;
+  ck_assert_int_eq(0, gameSetPlanning(game, &config));
+  ck_assert_int_eq(1, plan_best_move(game->planner, game, &best));
+  ck_assert_int_lt(config.beam, game->planner->nodes);
+  for (int i = 0; i < 20000 && game->stats.pause == PLAYING; i++) {
+    gameInputAt(game, gameAutoplay(game), false, now);
+    now += 5;
+    gameStepAt(game, now);
+  }
+  ck_assert_int_le(10, game->lines);
+  ck_assert_int_eq(0, gameSetPlanning(game, NULL));
+  ck_assert_ptr_null(game->planner);
+  gameDestroy(game);
+}
+END_TEST
+
+START_TEST(test40) {
+  Game_t* game = gameCreate(7);
+  Game_t* twin = gameCreate(7);
+  int64_t now = 0;
+  int lost = 0;
+  int changes = 0;
+
+  ck_assert_uint_eq(0, gameHash(game));
+  for (int i = 0; i < 3000; i++) {
+    uint64_t hash = gameHash(game);
+    UserAction_t action = game->stats.pause == PLAYING ? (i % 4 ? Down : Left)
+                                                       : Start;
+
+    lost += game->stats.pause == GAMELOST;
+    gameInputAt(game, action, false, now);
+    gameInputAt(twin, action, false, now);
+    now += 5;
+    gameStepAt(game, now);
+    gameStepAt(twin, now);
+    changes += gameHash(game) != hash;
+    ck_assert_uint_eq(board_hash(game), gameHash(game));
+    ck_assert_uint_eq(gameHash(game), gameHash(twin));
+  }
+  ck_assert_int_lt(0, lost);
+  ck_assert_int_lt(100, changes);
+  gameDestroy(twin);
+  gameDestroy(game);
+}
+END_TEST
+
+START_TEST(test41) {
+  char path[] = "/tmp/s21_high_score_XXXXXX";
+  int fd = mkstemp(path);
+  int score = 0;
+
+  ck_assert_int_ne(-1, fd);
+  FILE* file = fdopen(fd, "w");
+  fprintf(file, "42");
+  fclose(file);
+  highScoreSetPath(path);
+  ck_assert_int_eq(42, highScoreLoad("unused"));
+
+  ck_assert_int_eq(500, highScoreWrite(path, 500));
+  highScoreSubmit(100);
+  highScoreFlush();
+  file = fopen(path, "r");
+  ck_assert_ptr_nonnull(file);
+  ck_assert_int_eq(1, fscanf(file, "%d", &score));
+  fclose(file);
+  ck_assert_int_eq(500, score);
+  ck_assert_int_eq(500, highScoreLoad("unused"));
+
+  highScoreSetPath(NULL);
+  remove(path);
+}
+END_TEST
+
 int main() {
   int result;
   Suite* suite = suite_create("tetris_test");
@@ -332,6 +792,23 @@ int main() {
   tcase_add_test(tcase, test22);
   tcase_add_test(tcase, test23);
   tcase_add_test(tcase, test24);
+  tcase_add_test(tcase, test25);
+  tcase_add_test(tcase, test26);
+  tcase_add_test(tcase, test27);
+  tcase_add_test(tcase, test28);
+  tcase_add_test(tcase, test29);
+  tcase_add_test(tcase, test30);
+  tcase_add_test(tcase, test31);
+  tcase_add_test(tcase, test32);
+  tcase_add_test(tcase, test33);
+  tcase_add_test(tcase, test34);
+  tcase_add_test(tcase, test35);
+  tcase_add_test(tcase, test36);
+  tcase_add_test(tcase, test37);
+  tcase_add_test(tcase, test38);
+  tcase_add_test(tcase, test39);
+  tcase_add_test(tcase, test40);
+  tcase_add_test(tcase, test41);
 
   srunner_set_fork_status(srunner, CK_NOFORK);
   srunner_run_all(srunner, CK_NORMAL);
@@ -1,9 +1,11 @@
 #ifndef TETRIS_TEST_H
 #define TETRIS_TEST_H
 
+#define _DEFAULT_SOURCE
+
 #include <check.h>
 
-#include "../../brick_game/tetris/tetris_model.h"
+#include "../../brick_game/tetris/tetris_planner.h"
 #include "../../gui/cli/cli_controller.h"
 
 #endif
@@ -0,0 +1,540 @@
+#include "tetris_trainer.h"
+
+/// @file
+/**
+ * @brief Train
+ *
+ * Sets up a training with its population and runs it. The high score is
+ * kept in memory only, training never writes it to disk.
+ *
+ * @param config Trainer config structure
+ *
+ * @return 0 on success, 1 on failure
+ */
+int train(const TrainerConfig_t *config) {
+  Trainer_t trainer = {0};
+  int status = 1;
+
+  trainer.config = config;
+  trainer.population =
+      (Candidate_t *)calloc(config->population, sizeof(Candidate_t));
+  trainer.offspring =
+      (Candidate_t *)calloc(config->population, sizeof(Candidate_t));
+  trainer.lines = (int *)calloc((size_t)config->population * config->games,
+                                sizeof(int));
+  highScoreSetPath(NULL);
+  if (trainer.population && trainer.offspring && trainer.lines)
+    status = run_generations(&trainer);
+  free(trainer.population);
+  free(trainer.offspring);
+  free(trainer.lines);
+
+  return status;
+}
+
+/**
+ * @brief Run generations
+ *
+ * Runs the generations: the first population is random, every next one
+ * replaces the weakest candidates of the previous one with offspring.
+ * Every candidate plays the generation's games, the population is sorted
+ * by fitness, reported and saved. A population saved before is resumed
+ * from the generation after the saved one.
+ *
+ * @param trainer Trainer structure
+ *
+ * @return 0 on success, 1 on failure
+ */
+int run_generations(Trainer_t *trainer) {
+  const TrainerConfig_t *config = trainer->config;
+  Candidate_t *population = trainer->population;
+  int saved = -1;
+  int loaded = load_checkpoint(config->checkpoint, population,
+                               config->population, &saved);
+  int status = 0;
+
+  if (loaded < 0) {
+    fprintf(stderr, "%s isn't a population of %d candidates\n",
+            config->checkpoint, config->population);
+    status = 1;
+  } else if (loaded) {
+    printf("resuming after generation %d from %s\n", saved + 1,
+           config->checkpoint);
+  } else {
+    Rng_t rng;
+
+    rngSeed(&rng, config->seed ^ TRAINER_BREED_STREAM);
+    for (int i = 0; i < config->population; i++) {
+      random_weights(&population[i].weights, &rng);
+      population[i].fitness = 0;
+    }
+  }
+
+  double start = now_seconds();
+  for (int generation = saved + 1;
+       !status && generation < config->generations; generation++) {
+    if (generation > 0) breed(trainer, generation);
+    evaluate(trainer, generation);
+    qsort(population, config->population, sizeof(Candidate_t),
+          compare_candidates);
+    print_generation(config, population, generation,
+                     (generation - saved) / ((now_seconds() - start) / 60));
+    if (save_checkpoint(config->checkpoint, population, config->population,
+                        generation)) {
+      fprintf(stderr, "can't save the population to %s\n",
+              config->checkpoint);
+      status = 1;
+    }
+  }
+
+  return status;
+}
+
+/**
+ * @brief Evaluate
+ *
+ * Plays the games of a generation for every candidate on all threads and
+ * sets the fitness of every candidate. All candidates play the same
+ * seeded games, game i of generation g uses seed + g * games + i.
+ * Each thread gets an equal share of the games; game lengths vary a lot,
+ * so a thread which runs out of games steals them from the others.
+ *
+ * @param trainer Trainer structure
+ * @param generation Index of the generation
+ */
+void evaluate(Trainer_t *trainer, int generation) {
+  const TrainerConfig_t *config = trainer->config;
+  Candidate_t *population = trainer->population;
+  int *lines = trainer->lines;
+  TrainerPool_t *pool = &trainer->pool;
+  pthread_t threads[TRAINER_MAX_THREADS];
+  TrainerWorker_t workers[TRAINER_MAX_THREADS];
+  long tasks = (long)config->population * config->games;
+  int started = 0;
+
+  pool->config = config;
+  pool->population = population;
+  pool->seed = config->seed + (uint64_t)generation * config->games;
+  pool->lines = lines;
+  for (int i = 0; i < config->threads; i++) {
+    pool->deques[i].top = tasks * i / config->threads;
+    pool->deques[i].bottom = tasks * (i + 1) / config->threads;
+    pthread_mutex_init(&pool->deques[i].lock, NULL);
+    workers[i].pool = pool;
+    workers[i].id = i;
+  }
+
+  for (int i = 1; i < config->threads; i++) {
+    if (pthread_create(&threads[started], NULL, trainer_worker,
+                       &workers[i]) == 0)
+      started++;
+  }
+  trainer_worker(&workers[0]);
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  for (int i = 0; i < config->threads; i++) {
+    pthread_mutex_destroy(&pool->deques[i].lock);
+  }
+  for (int i = 0; i < config->population; i++) {
+    const int *games = lines + (long)i * config->games;
+    long sum = 0;
+
+    for (int j = 0; j < config->games; j++) sum += games[j];
+    population[i].fitness = (double)sum / config->games;
+  }
+}
+
+/**
+ * @brief Trainer worker
+ *
+ * Thread body: plays games until no deque has any left.
+ *
+ * @param arg Trainer worker structure
+ *
+ * @return Nothing
+ */
+void *trainer_worker(void *arg) {
+  TrainerWorker_t *worker = (TrainerWorker_t *)arg;
+  TrainerPool_t *pool = worker->pool;
+  int games = pool->config->games;
+  long task;
+
+  while (take_task(pool, worker->id, &task)) {
+    const Candidate_t *candidate = &pool->population[task / games];
+    pool->lines[task] = play_game(&candidate->weights,
+                                  pool->seed + (uint64_t)(task % games),
+                                  pool->config->max_ticks);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Take task
+ *
+ * Takes the next game of a worker from the bottom of its own deque. If it
+ * is empty, steals one from the top of the next non-empty deque.
+ * A thread which failed to start leaves its deque to the others.
+ *
+ * @param pool Trainer pool structure
+ * @param id Index of the worker
+ * @param task Index of the game taken
+ *
+ * @return 1 if a game is taken, 0 if there are none left
+ */
+int take_task(TrainerPool_t *pool, int id, long *task) {
+  int threads = pool->config->threads;
+  int taken = 0;
+
+  for (int i = 0; !taken && i < threads; i++) {
+    TaskDeque_t *deque = &pool->deques[(id + i) % threads];
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top < deque->bottom) {
+      *task = i == 0 ? --deque->bottom : deque->top++;
+      taken = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+  }
+
+  return taken;
+}
+
+/**
+ * @brief Play game
+ *
+ * Plays a single game with the bot using the given weights, from start
+ * to its end or to the tick limit. The game runs on virtual time, one
+ * frame per tick, and does all of the game logic itself, the trainer only
+ * supplies the inputs.
+ *
+ * @param weights Bot weights struct
+ * @param seed Seed of the game
+ * @param max_ticks Tick limit
+ *
+ * @return Lines removed in the game
+ */
+int play_game(const BotWeights_t *weights, uint64_t seed, long max_ticks) {
+  Game_t *game = gameCreate(seed);
+  int lines = 0;
+  int64_t now = 0;
+
+  if (game) {
+    gameInputAt(game, Start, false, now);
+    gameStepAt(game, now);
+    for (long tick = 0; gameSnapshot(game).pause == PLAYING && tick < max_ticks;
+         tick++) {
+      gameInputAt(game, bot_action(game, weights), false, now);
+      now += TRAINER_FRAME_MS;
+      gameStepAt(game, now);
+    }
+    lines = gameLines(game);
+    gameDestroy(game);
+  }
+
+  return lines;
+}
+
+/**
+ * @brief Breed
+ *
+ * Replaces the weakest TRAINER_OFFSPRING percent of a sorted population
+ * with offspring of tournament winners, mutated with a chance of
+ * TRAINER_MUTATION percent. The offspring of a generation only depend on
+ * the seed, the generation and the population, so a resumed training
+ * goes on the same way.
+ *
+ * @param trainer Trainer structure, its population best first
+ * @param generation Index of the generation the offspring are bred for
+ */
+void breed(Trainer_t *trainer, int generation) {
+  const TrainerConfig_t *config = trainer->config;
+  Candidate_t *population = trainer->population;
+  Candidate_t *offspring = trainer->offspring;
+  int count = config->population * TRAINER_OFFSPRING / 100;
+  Rng_t rng;
+
+  if (count < 1) count = 1;
+  rngSeed(&rng, (config->seed + (uint64_t)generation) ^ TRAINER_BREED_STREAM);
+  for (int i = 0; i < count; i++) {
+    const Candidate_t *first;
+    const Candidate_t *second;
+
+    tournament(config, population, &rng, &first, &second);
+    crossover(first, second, &offspring[i].weights);
+    if (rngBounded(&rng, 100) < TRAINER_MUTATION)
+      mutate(&offspring[i].weights, &rng);
+    offspring[i].fitness = 0;
+  }
+  memcpy(population + config->population - count, offspring,
+         count * sizeof(Candidate_t));
+}
+
+/**
+ * @brief Tournament
+ *
+ * Draws TRAINER_TOURNAMENT percent of the population, at least two
+ * candidates, and picks the two fittest of them.
+ *
+ * @param config Trainer config structure
+ * @param population Array of config->population candidates
+ * @param rng Random number generator
+ * @param first Fittest candidate drawn
+ * @param second Second fittest candidate drawn
+ */
+void tournament(const TrainerConfig_t *config, const Candidate_t *population,
+                Rng_t *rng, const Candidate_t **first,
+                const Candidate_t **second) {
+  int size = config->population * TRAINER_TOURNAMENT / 100;
+
+  if (size < 2) size = 2;
+  *first = NULL;
+  *second = NULL;
+  for (int i = 0; i < size; i++) {
+    const Candidate_t *drawn = &population[rngBounded(rng, config->population)];
+
+    if (!*first || drawn->fitness > (*first)->fitness) {
+      *second = *first;
+      *first = drawn;
+    } else if (!*second || drawn->fitness > (*second)->fitness) {
+      *second = drawn;
+    }
+  }
+}
+
+/**
+ * @brief Crossover
+ *
+ * Makes a child of two candidates: the sum of their weights weighted
+ * by their fitness, of unit length.
+ *
+ * @param first First parent
+ * @param second Second parent
+ * @param child Weights of the child
+ */
+void crossover(const Candidate_t *first, const Candidate_t *second,
+               BotWeights_t *child) {
+  double a = first->fitness;
+  double b = second->fitness;
+
+  if (a + b <= 0) a = b = 1;
+  child->height = a * first->weights.height + b * second->weights.height;
+  child->lines = a * first->weights.lines + b * second->weights.lines;
+  child->holes = a * first->weights.holes + b * second->weights.holes;
+  child->bumpiness =
+      a * first->weights.bumpiness + b * second->weights.bumpiness;
+  normalize(child);
+}
+
+/**
+ * @brief Mutate
+ *
+ * Shifts one random weight by up to TRAINER_MUTATION_STEP either way and
+ * brings the weights back to unit length.
+ *
+ * @param weights Bot weights struct
+ * @param rng Random number generator
+ */
+void mutate(BotWeights_t *weights, Rng_t *rng) {
+  double *components[] = {&weights->height, &weights->lines, &weights->holes,
+                          &weights->bumpiness};
+
+  *components[rngBounded(rng, 4)] +=
+      (rng_unit(rng) * 2 - 1) * TRAINER_MUTATION_STEP;
+  normalize(weights);
+}
+
+/**
+ * @brief Random weights
+ *
+ * Draws every weight from [-0.5, 0.5) and brings them to unit length.
+ *
+ * @param weights Bot weights struct
+ * @param rng Random number generator
+ */
+void random_weights(BotWeights_t *weights, Rng_t *rng) {
+  weights->height = rng_unit(rng) - 0.5;
+  weights->lines = rng_unit(rng) - 0.5;
+  weights->holes = rng_unit(rng) - 0.5;
+  weights->bumpiness = rng_unit(rng) - 0.5;
+  normalize(weights);
+}
+
+/**
+ * @brief Normalize
+ *
+ * Scales the weights to unit length. Only the direction of the weights
+ * matters to the bot, the best placement doesn't depend on the length.
+ *
+ * @param weights Bot weights struct
+ */
+void normalize(BotWeights_t *weights) {
+  double length =
+      sqrt(weights->height * weights->height + weights->lines * weights->lines +
+           weights->holes * weights->holes +
+           weights->bumpiness * weights->bumpiness);
+
+  if (length > 0) {
+    weights->height /= length;
+    weights->lines /= length;
+    weights->holes /= length;
+    weights->bumpiness /= length;
+  }
+}
+
+/**
+ * @brief Random unit number
+ *
+ * Returns a random number in [0, 1).
+ *
+ * @param rng Random number generator
+ *
+ * @return Random number
+ */
+double rng_unit(Rng_t *rng) { return rngNext(rng) / 4294967296.0; }
+
+/**
+ * @brief Compare candidates
+ *
+ * Orders candidates by fitness, the fittest first, for qsort().
+ *
+ * @param a First candidate
+ * @param b Second candidate
+ *
+ * @return Comparison result
+ */
+int compare_candidates(const void *a, const void *b) {
+  double first = ((const Candidate_t *)a)->fitness;
+  double second = ((const Candidate_t *)b)->fitness;
+
+  return (first < second) - (first > second);
+}
+
+/**
+ * @brief Save checkpoint
+ *
+ * Writes the population into a temporary file next to the checkpoint,
+ * syncs it and renames it over the checkpoint, then syncs the directory,
+ * so neither an interrupted save nor a crash of the system leaves
+ * a broken one. The file is text: a format line, the generation,
+ * the population size and a line of weights and fitness per candidate.
+ *
+ * @param path Path of the checkpoint
+ * @param population Array of candidates
+ * @param count Number of candidates
+ * @param generation Index of the generation
+ *
+ * @return 0 on success, 1 on failure
+ */
+int save_checkpoint(const char *path, const Candidate_t *population,
+                    int count, int generation) {
+  char temporary[4096];
+  int status = 1;
+  FILE *file;
+
+  snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+  if ((file = fopen(temporary, "w")) != NULL) {
+    fprintf(file, "%s\ngeneration %d\npopulation %d\n", TRAINER_FORMAT,
+            generation, count);
+    for (int i = 0; i < count; i++) {
+      const BotWeights_t *w = &population[i].weights;
+      fprintf(file, "%.17g %.17g %.17g %.17g %.17g\n", w->height, w->lines,
+              w->holes, w->bumpiness, population[i].fitness);
+    }
+    int synced = sync_file(file) == 0;
+
+    status = fclose(file) != 0 || !synced || rename(temporary, path) != 0;
+    if (status)
+      remove(temporary);
+    else
+      highScoreSyncDir(path);
+  }
+
+  return status;
+}
+
+/**
+ * @brief Load checkpoint
+ *
+ * Reads a population saved by save_checkpoint().
+ *
+ * @param path Path of the checkpoint
+ * @param population Array of candidates to fill
+ * @param count Number of candidates expected
+ * @param generation Index of the saved generation
+ *
+ * @return 1 if loaded, 0 if there is no checkpoint, -1 if it is broken
+ *         or of another population size
+ */
+int load_checkpoint(const char *path, Candidate_t *population, int count,
+                    int *generation) {
+  FILE *file = fopen(path, "r");
+  int loaded = 0;
+
+  if (file) {
+    char format[32] = "";
+    int saved_count = 0;
+
+    loaded = fgets(format, sizeof(format), file) &&
+                     strncmp(format, TRAINER_FORMAT,
+                             strlen(TRAINER_FORMAT)) == 0 &&
+                     fscanf(file, " generation %d population %d", generation,
+                            &saved_count) == 2 &&
+                     saved_count == count
+                 ? 1
+                 : -1;
+    for (int i = 0; loaded == 1 && i < count; i++) {
+      BotWeights_t *w = &population[i].weights;
+      if (fscanf(file, "%lf %lf %lf %lf %lf", &w->height, &w->lines,
+                 &w->holes, &w->bumpiness, &population[i].fitness) != 5)
+        loaded = -1;
+    }
+    fclose(file);
+  }
+
+  return loaded;
+}
+
+/**
+ * @brief Print generation
+ *
+ * Prints the fitness of the best candidate and of the population,
+ * the training speed and the weights of the best candidate.
+ *
+ * @param config Trainer config structure
+ * @param population Array of candidates, best first
+ * @param generation Index of the generation
+ * @param rate Generations per minute
+ */
+void print_generation(const TrainerConfig_t *config,
+                      const Candidate_t *population, int generation,
+                      double rate) {
+  const BotWeights_t *w = &population[0].weights;
+  double mean = 0;
+
+  for (int i = 0; i < config->population; i++) mean += population[i].fitness;
+  mean /= config->population;
+
+  printf("generation %d/%d  best %.1f  mean %.1f lines  %.2f gen/min\n",
+         generation + 1, config->generations, population[0].fitness, mean,
+         rate);
+  printf("  weights   height %.6f  lines %.6f  holes %.6f  bumpiness %.6f\n",
+         w->height, w->lines, w->holes, w->bumpiness);
+  fflush(stdout);
+}
+
+/**
+ * @brief Now seconds
+ *
+ * Reads the monotonic clock.
+ *
+ * @return Current time in seconds
+ */
+double now_seconds() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,117 @@
+#ifndef TETRIS_TRAINER_H
+#define TETRIS_TRAINER_H
+
+#define _DEFAULT_SOURCE
+
+/// @file
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../brick_game/common/high_score.h"
+#include "../brick_game/tetris/tetris_bot.h"
+#include "trainer_cli.h"
+
+#define TRAINER_FRAME_MS 5
+#define TRAINER_TOURNAMENT 10
+#define TRAINER_OFFSPRING 30
+#define TRAINER_MUTATION 5
+#define TRAINER_MUTATION_STEP 0.2
+#define TRAINER_BREED_STREAM 0xda942042e4dd58b5ULL
+#define TRAINER_FORMAT "tetris-trainer 1"
+
+/**
+ * @brief Candidate struct
+ *
+ * A weight vector of the bot evaluation, of unit length, and its fitness:
+ * the mean number of lines it has removed in the games of the last
+ * generation.
+ */
+typedef struct {
+  BotWeights_t weights;
+  double fitness;
+} Candidate_t;
+
+/**
+ * @brief Task deque struct
+ *
+ * Games of a single worker, a range of task indices. The worker takes
+ * tasks from the bottom, other workers steal them from the top.
+ */
+typedef struct {
+  long top;
+  long bottom;
+  pthread_mutex_t lock;
+} TaskDeque_t;
+
+/**
+ * @brief Trainer pool struct
+ *
+ * A generation being played: the config, the population, the seed
+ * of the generation's first game, lines of every game, indexed by
+ * candidate and game, and a task deque per worker.
+ */
+typedef struct {
+  const TrainerConfig_t *config;
+  const Candidate_t *population;
+  uint64_t seed;
+  int *lines;
+  TaskDeque_t deques[TRAINER_MAX_THREADS];
+} TrainerPool_t;
+
+/**
+ * @brief Trainer worker struct
+ *
+ * Everything a worker thread needs: the pool and its own deque.
+ */
+typedef struct {
+  TrainerPool_t *pool;
+  int id;
+} TrainerWorker_t;
+
+/**
+ * @brief Trainer struct
+ *
+ * A training, owned by whoever runs it: the config, the population,
+ * the offspring bred for the next generation, lines of every game,
+ * indexed by candidate and game, and the pool the generations are played
+ * on. Nothing of a training is kept outside of it, so trainings don't
+ * share any state.
+ */
+typedef struct {
+  const TrainerConfig_t *config;
+  Candidate_t *population;
+  Candidate_t *offspring;
+  int *lines;
+  TrainerPool_t pool;
+} Trainer_t;
+
+int run_generations(Trainer_t *trainer);
+void evaluate(Trainer_t *trainer, int generation);
+void *trainer_worker(void *arg);
+int take_task(TrainerPool_t *pool, int id, long *task);
+int play_game(const BotWeights_t *weights, uint64_t seed, long max_ticks);
+void breed(Trainer_t *trainer, int generation);
+void tournament(const TrainerConfig_t *config, const Candidate_t *population,
+                Rng_t *rng, const Candidate_t **first,
+                const Candidate_t **second);
+void crossover(const Candidate_t *first, const Candidate_t *second,
+               BotWeights_t *child);
+void mutate(BotWeights_t *weights, Rng_t *rng);
+void random_weights(BotWeights_t *weights, Rng_t *rng);
+void normalize(BotWeights_t *weights);
+double rng_unit(Rng_t *rng);
+int compare_candidates(const void *a, const void *b);
+int save_checkpoint(const char *path, const Candidate_t *population,
+                    int count, int generation);
+int load_checkpoint(const char *path, Candidate_t *population, int count,
+                    int *generation);
+void print_generation(const TrainerConfig_t *config,
+                      const Candidate_t *population, int generation,
+                      double rate);
+double now_seconds();
+
+#endif
@@ -0,0 +1,138 @@
+#define _DEFAULT_SOURCE
+
+#include "trainer_cli.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/// @file
+/**
+ * @brief Entry point
+ *
+ * Execution of the trainer starts here. Evolves the weights of the tetris
+ * bot evaluation and prints a report of every generation. Command line
+ * handling and syncing files live apart from the trainer, as unistd.h
+ * clashes with the tetris model.
+ *
+ * @param argc Number of arguments
+ * @param argv List of arguments
+ *
+ * @return Program exit status
+ */
+int main(int argc, char **argv) {
+  TrainerConfig_t config;
+  int status = parse_args(argc, argv, &config);
+
+  if (status)
+    print_usage(argv[0]);
+  else
+    status = train(&config);
+
+  return status;
+}
+
+/**
+ * @brief Parse arguments
+ *
+ * Fills the config with defaults and overrides them from the command line.
+ *
+ * @param argc Number of arguments
+ * @param argv List of arguments
+ * @param config Trainer config structure
+ *
+ * @return Parsing status
+ */
+int parse_args(int argc, char **argv, TrainerConfig_t *config) {
+  int error = 0;
+  int opt;
+
+  config->population = TRAINER_DEFAULT_POPULATION;
+  config->games = TRAINER_DEFAULT_GAMES;
+  config->generations = TRAINER_DEFAULT_GENERATIONS;
+  config->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  config->seed = 1;
+  config->max_ticks = TRAINER_DEFAULT_MAX_TICKS;
+  config->checkpoint = TRAINER_DEFAULT_CHECKPOINT;
+
+  while (!error && (opt = getopt(argc, argv, "p:g:n:t:s:m:c:")) != -1) {
+    switch (opt) {
+      case 'p':
+        config->population = atoi(optarg);
+        break;
+
+      case 'g':
+        config->games = atoi(optarg);
+        break;
+
+      case 'n':
+        config->generations = atoi(optarg);
+        break;
+
+      case 't':
+        config->threads = atoi(optarg);
+        break;
+
+      case 's':
+        config->seed = strtoull(optarg, NULL, 10);
+        break;
+
+      case 'm':
+        config->max_ticks = atol(optarg);
+        break;
+
+      case 'c':
+        config->checkpoint = optarg;
+        break;
+
+      default:
+        error = 1;
+    }
+  }
+
+  if (config->threads < 1) config->threads = 1;
+  if (config->threads > TRAINER_MAX_THREADS)
+    config->threads = TRAINER_MAX_THREADS;
+  if (config->population < 4 || config->population > TRAINER_MAX_POPULATION ||
+      config->games < 1 || config->generations < 1 || config->max_ticks < 1)
+    error = 1;
+
+  return error;
+}
+
+/**
+ * @brief Print usage
+ *
+ * Prints command line options of the trainer.
+ *
+ * @param name Program name
+ */
+void print_usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s [-p population] [-g games] [-n generations]\n"
+          "          [-t threads] [-s seed] [-m max_ticks] [-c checkpoint]\n"
+          "  -p  number of candidates, 4 to %d (%d)\n"
+          "  -g  games every candidate plays in a generation (%d)\n"
+          "  -n  generation to stop after (%d)\n"
+          "  -t  number of threads (all cores)\n"
+          "  -s  seed of the training (1)\n"
+          "  -m  tick limit of a single game (%d)\n"
+          "  -c  population file, training resumes from it if it exists\n"
+          "      (%s)\n",
+          name, TRAINER_MAX_POPULATION, TRAINER_DEFAULT_POPULATION,
+          TRAINER_DEFAULT_GAMES, TRAINER_DEFAULT_GENERATIONS,
+          TRAINER_DEFAULT_MAX_TICKS, TRAINER_DEFAULT_CHECKPOINT);
+}
+
+/**
+ * @brief Sync file
+ *
+ * Flushes a stream and syncs its file to disk.
+ *
+ * @param file Stream of the file
+ *
+ * @return 0 on success, -1 on failure
+ */
+int sync_file(FILE *file) {
+  return fflush(file) == 0 && fsync(fileno(file)) == 0 ? 0 : -1;
+}
@@ -0,0 +1,38 @@
+#ifndef TRAINER_CLI_H
+#define TRAINER_CLI_H
+
+/// @file
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRAINER_DEFAULT_POPULATION 32
+#define TRAINER_DEFAULT_GAMES 100
+#define TRAINER_DEFAULT_GENERATIONS 10
+#define TRAINER_DEFAULT_MAX_TICKS 50000
+#define TRAINER_DEFAULT_CHECKPOINT "tetris_trainer.pop"
+#define TRAINER_MAX_THREADS 256
+#define TRAINER_MAX_POPULATION 1024
+
+/**
+ * @brief Trainer config struct
+ *
+ * Holds the training settings: population size, games played by every
+ * candidate in a generation, number of generations, number of threads,
+ * base seed, tick limit of a single game and the checkpoint path.
+ */
+typedef struct {
+  int population;
+  int games;
+  int generations;
+  int threads;
+  uint64_t seed;
+  long max_ticks;
+  const char *checkpoint;
+} TrainerConfig_t;
+
+int parse_args(int argc, char **argv, TrainerConfig_t *config);
+void print_usage(const char *name);
+int sync_file(FILE *file);
+int train(const TrainerConfig_t *config);
+
+#endif